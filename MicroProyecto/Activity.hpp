@@ -0,0 +1,216 @@
+#pragma once
+
+/**
+ * @file Activity.hpp
+ * @brief Registro de tiles activos para saltar las regiones de la cuadrícula que no cambian.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Parameters.hpp"
+#include "Tiles.hpp"
+
+using namespace std;
+
+/**
+ * @struct Tile_State
+ * @brief Resumen de un tile en el búfer actual.
+ */
+struct Tile_State {
+	bool uniform;     /**< Todas las células tienen la misma especie. */
+	Species species;  /**< Esa especie, si uniform. */
+	int expiry;       /**< Tick en que muere la planta más vieja del tile (INT_MAX si no hay plantas). */
+	int animals;      /**< Herbívoros y carnívoros (peso del tile en Tile_Scheduler). */
+	bool idle;        /**< El tile no se procesó en el último tick. */
+};
+
+/**
+ * @struct Active_Tiles
+ * @brief Mapa de bits de los tiles que hay que procesar en cada tick.
+ *
+ * Un tile está inactivo cuando él y sus 8 vecinos son todos plantas (o todos vacíos, si no hay
+ * aparición espontánea) y ninguna planta llega a su edad máxima. En ese caso update_cell no cambiaría
+ * nada: las plantas envejecen solas porque guardan su tick de nacimiento (Cell::plant_age), nadie
+ * escribe en el tile y el tile no escribe fuera. El tile vuelve a estar activo en el tick en que muere
+ * su planta más vieja (Tile_State::expiry). Mientras un tile sigue inactivo sus dos búferes son
+ * iguales, así que tampoco se copia, y sus planos de bits no se reconstruyen.
+ */
+struct Active_Tiles {
+	vector<uint64_t> active;    /**< Un bit por tile (Tile::id): el tile se procesa este tick. */
+	vector<Tile_State> states;  /**< Resumen de cada tile. */
+	vector<bool> pinned;        /**< Tiles que se procesan siempre (junto al borde de una franja, cuyos vecinos viven en otro proceso). */
+	int max_plant_age;          /**< Edad máxima de las plantas antes de morir. */
+	bool empty_is_stable;       /**< Las células vacías solo son estables si nunca aparece nada espontáneamente. */
+	bool torus;                 /**< Los tiles del borde son vecinos de los del borde opuesto (Border::Torus). */
+
+	/**
+	 * @brief Crea el registro con todos los tiles activos.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param species Constantes de las especies.
+	 * @param torus Los tiles del borde son vecinos de los del borde opuesto.
+	 */
+	Active_Tiles(const Tile_Phases& phases, const Species_Parameters& species, const bool& torus = false):
+		active((phases.tiles.size() + 63) / 64, ~uint64_t(0)),
+		states(phases.tiles.size(), Tile_State{ false, Species::Empty, INT_MAX, 0, false }),
+		pinned(phases.tiles.size(), false),
+		max_plant_age(species.max_plant_age),
+		empty_is_stable(species.plant_after_spawn_rate <= 0.0 && species.carnivore_after_spawn_rate <= 0.0 && species.herbivore_after_spawn_rate <= 0.0),
+		torus(torus) {}
+
+	/**
+	 * @brief Marca una fila de tiles para que se procese en todos los ticks.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param tx Fila de tiles.
+	 */
+	void pin_row(const Tile_Phases& phases, const int& tx) {
+		for (int ty = 0; ty < phases.tiles_y; ++ty) {
+			pinned[tx * phases.tiles_y + ty] = true;
+		}
+	}
+
+	/** @return El tile se procesa en este tick. */
+	bool is_active(const int& id) const { return (active[id >> 6] >> (id & 63)) & 1u; }
+
+	/**
+	 * @brief Recalcula el resumen de un tile a partir del búfer actual.
+	 * @param grid Cuadrícula.
+	 * @param tile Tile a resumir.
+	 * @param tick Tick que procesará el búfer actual.
+	 */
+	template<typename Grid_Type>
+	void scan(const Grid_Type& grid, const Tile& tile, const int& tick) {
+		const Grid_Buffer& cells = grid.current();
+		Tile_State& state = states[tile.id];
+		const Species first = cells[grid.index(tile.x0, tile.y0)].species();
+		bool uniform = true;
+		int oldest = -1;
+		int animals = 0;
+		for (int i = tile.x0; i < tile.x1; ++i) {
+			for (int j = tile.y0; j < tile.y1; ++j) {
+				const Cell& cell = cells[grid.index(i, j)];
+				uniform &= cell.species() == first;
+				if (cell.species() == Species::Plant) {
+					oldest = max(oldest, cell.plant_age(tick));
+				}
+				animals += cell.species() >= Species::Herbivore;
+			}
+		}
+		state.uniform = uniform;
+		state.animals = animals;
+		state.species = first;
+		state.expiry = oldest < 0 ? INT_MAX : tick + max_plant_age + 1 - oldest;
+	}
+
+	/**
+	 * @brief Decide qué tiles se procesan en este tick. Debe llamarse desde todos los hilos de una región omp parallel.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param tick Tick que se va a calcular.
+	 */
+	void classify(const Tile_Phases& phases, const int& tick) {
+		#pragma omp for
+		for (int w = 0; w < int(active.size()); ++w) {
+			uint64_t word = 0;
+			for (int id = w * 64; id < min(int(states.size()), (w + 1) * 64); ++id) {
+				word |= uint64_t(!stable(phases, id, tick)) << (id & 63);
+			}
+			active[w] = word;
+		}
+	}
+
+	/**
+	 * @brief Prepara el búfer siguiente. Debe llamarse desde todos los hilos de una región omp parallel.
+	 *
+	 * Los tiles activos se copian; los que recién quedan inactivos se copian una última vez; los que
+	 * siguen inactivos no se tocan.
+	 * @param grid Cuadrícula.
+	 * @param phases Tiles de la cuadrícula.
+	 */
+	template<typename Grid_Type>
+	void sync(Grid_Type& grid, const Tile_Phases& phases) {
+		#pragma omp for schedule(dynamic)
+		for (int id = 0; id < int(phases.tiles.size()); ++id) {
+			const Tile& tile = phases.tiles[id];
+			Tile_State& state = states[id];
+			if (is_active(id)) {
+				copy_tile(grid, tile);
+				state.idle = false;
+			}
+			else if (!state.idle) {
+				copy_tile(grid, tile);
+				state.idle = true;
+			}
+		}
+	}
+
+	/** @brief El búfer siguiente se reemplazó (ver Basic_Grid::swap(Grid_Buffer&)): los tiles inactivos se vuelven a copiar una vez. */
+	void forget_idle() {
+		for (Tile_State& state : states) {
+			state.idle = false;
+		}
+	}
+
+	/**
+	 * @brief Actualiza el resumen de los tiles procesados en este tick. Debe llamarse desde todos los hilos de una región omp parallel, después de Grid::swap.
+	 * @param grid Cuadrícula.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param tick Tick que procesará el nuevo búfer actual.
+	 */
+	template<typename Grid_Type>
+	void rescan(const Grid_Type& grid, const Tile_Phases& phases, const int& tick) {
+		#pragma omp for schedule(dynamic)
+		for (int id = 0; id < int(phases.tiles.size()); ++id) {
+			if (is_active(id)) {
+				scan(grid, phases.tiles[id], tick);
+			}
+		}
+	}
+
+private:
+	/** @return El tile y sus vecinos son estables este tick. */
+	bool stable(const Tile_Phases& phases, const int& id, const int& tick) const {
+		const Tile_State& state = states[id];
+		if (!state.uniform || pinned[id]) {
+			return false;
+		}
+		if (state.species == Species::Plant) {
+			if (tick >= state.expiry) {
+				return false;
+			}
+		}
+		else if (!(state.species == Species::Empty && empty_is_stable)) {
+			return false;
+		}
+		const int tx = id / phases.tiles_y;
+		const int ty = id % phases.tiles_y;
+		for (int dx = -1; dx <= 1; ++dx) {
+			for (int dy = -1; dy <= 1; ++dy) {
+				int nx = tx + dx;
+				int ny = ty + dy;
+				if (torus) {
+					nx = (nx + phases.tiles_x) % phases.tiles_x;
+					ny = (ny + phases.tiles_y) % phases.tiles_y;
+				}
+				else if (nx < 0 || nx >= phases.tiles_x || ny < 0 || ny >= phases.tiles_y) {
+					continue;
+				}
+				const Tile_State& neighbor = states[nx * phases.tiles_y + ny];
+				if (!neighbor.uniform || neighbor.species != state.species) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/** @brief Copia el tile del búfer actual al siguiente. */
+	template<typename Grid_Type>
+	void copy_tile(Grid_Type& grid, const Tile& tile) {
+		for (int i = tile.x0; i < tile.x1; ++i) {
+			grid.sync_span(i, tile.y0, tile.y1);
+		}
+	}
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+/**
+ * @file Benchmark.hpp
+ * @brief Mediciones sin salida en la terminal: ticks por segundo y curvas de escalado fuerte y débil.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include "Parameters.hpp"
+#include "Simulation.hpp"
+
+using namespace std;
+
+/**
+ * @struct Benchmark_Point
+ * @brief Un punto medido: una configuración de hilos y cuadrícula corrida params.repeats veces.
+ */
+struct Benchmark_Point {
+	int threads;              /**< Hilos utilizados. */
+	int rows;                 /**< Filas de la cuadrícula. */
+	int cols;                 /**< Columnas de la cuadrícula. */
+	vector<double> seconds;   /**< Duración de los ticks de cada corrida. */
+	double mean;              /**< Media de ticks por segundo. */
+	double stddev;            /**< Desviación estándar muestral de ticks por segundo. */
+	double min;               /**< Mínimo de ticks por segundo. */
+	double max;               /**< Máximo de ticks por segundo. */
+	double cell_updates;      /**< Media de células actualizadas por segundo. */
+	double speedup;           /**< Células por segundo respecto al primer punto. */
+	double efficiency;        /**< speedup dividido por la proporción de hilos respecto al primer punto. */
+	double idle;              /**< Fracción media del tiempo de los hilos sin trabajo en las fases de tiles (ver Tile_Scheduler). */
+};
+
+/**
+ * @brief Mide los ticks de una corrida, sin la inicialización de la cuadrícula.
+ * @param params Parámetros de la corrida.
+ * @param idle Fracción del tiempo de los hilos sin trabajo en las fases de tiles.
+ * @return Segundos que tardaron los params.ticks ticks.
+ */
+inline double time_run(const Parameters& params, double& idle) {
+	double seconds = 0.0;
+	with_layout(params.layout, [&](auto layout) {
+		Basic_Ecosystem<typename decltype(layout)::type> ecosystem(params);
+		with_rules(params.species, [&](const auto& rules) {
+			initialize_grid(ecosystem, rules);
+			chrono::steady_clock::time_point start;
+			#pragma omp parallel num_threads(params.threads)
+			{
+				ecosystem.planes.build(ecosystem.grid);
+				#pragma omp single
+				{
+					start = chrono::steady_clock::now();
+				}
+				for (int tick = 0; tick < params.ticks; ++tick) {
+					if (params.temporal_block > 1) {
+						const int count = min(params.temporal_block, params.ticks - tick);
+						advance_block(ecosystem, tick, count, rules, [](const Tick_Record&) {});
+						tick += count - 1;
+					}
+					else {
+						advance(ecosystem, tick, rules);
+					}
+				}
+			}
+			const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+			seconds = elapsed.count();
+		});
+		idle = ecosystem.scheduler.idle_fraction();
+	});
+	return seconds;
+}
+
+/**
+ * @brief Corre una configuración params.repeats veces y resume los ticks por segundo.
+ * @param params Parámetros de la corrida.
+ */
+inline Benchmark_Point measure(const Parameters& params) {
+	Benchmark_Point point = { params.threads, params.rows, params.cols, {}, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 0.0 };
+	vector<double> rates;
+	for (int r = 0; r < params.repeats; ++r) {
+		double idle = 0.0;
+		point.seconds.push_back(time_run(params, idle));
+		rates.push_back(params.ticks / point.seconds.back());
+		point.idle += idle / params.repeats;
+	}
+	for (const double& rate : rates) {
+		point.mean += rate / rates.size();
+	}
+	for (const double& rate : rates) {
+		point.stddev += (rate - point.mean) * (rate - point.mean);
+	}
+	point.stddev = rates.size() > 1 ? sqrt(point.stddev / (rates.size() - 1)) : 0.0;
+	point.min = *min_element(rates.begin(), rates.end());
+	point.max = *max_element(rates.begin(), rates.end());
+	point.cell_updates = point.mean * double(params.rows) * params.cols;
+	return point;
+}
+
+/**
+ * @brief Números de hilos de una curva de escalado: potencias de 2 desde 1 y, al final, max_threads.
+ * @param max_threads Último número de hilos.
+ */
+inline vector<int> thread_counts(const int& max_threads) {
+	vector<int> counts;
+	for (int threads = 1; threads < max_threads; threads *= 2) {
+		counts.push_back(threads);
+	}
+	counts.push_back(max_threads);
+	return counts;
+}
+
+/**
+ * @brief Corre el benchmark elegido en params.benchmark.
+ * @param params Parámetros base; en las curvas se cambian threads (y rows en escalado débil).
+ * @return Puntos medidos, con speedup y eficiencia respecto al primero.
+ */
+inline vector<Benchmark_Point> run_benchmark(const Parameters& params) {
+	vector<Benchmark_Point> points;
+	if (params.benchmark == Benchmark::Single) {
+		points.push_back(measure(params));
+		return points;
+	}
+	const int max_threads = params.max_threads > 0 ? params.max_threads : omp_get_num_procs();
+	for (const int& threads : thread_counts(max_threads)) {
+		Parameters run = params;
+		run.threads = threads;
+		if (params.benchmark == Benchmark::Weak) {
+			run.rows = params.rows * threads;
+		}
+		points.push_back(measure(run));
+		const Benchmark_Point& base = points.front();
+		Benchmark_Point& point = points.back();
+		point.speedup = point.cell_updates / base.cell_updates;
+		point.efficiency = point.speedup * base.threads / point.threads;
+	}
+	return points;
+}
+
+/**
+ * @brief Escribe el informe de un benchmark en JSON o CSV.
+ * @param out Flujo de salida.
+ * @param params Parámetros base del benchmark.
+ * @param points Puntos medidos.
+ */
+inline void write_report(ostream& out, const Parameters& params, const vector<Benchmark_Point>& points) {
+	static const char* modes[] = { "none", "single", "strong", "weak" };
+	const char* mode = modes[int(params.benchmark)];
+	if (params.format == Report_Format::Csv) {
+		out << "benchmark,threads,rows,cols,ticks,repeats,ticks_per_second,ticks_per_second_stddev,ticks_per_second_min,ticks_per_second_max,cell_updates_per_second,speedup,efficiency,idle_fraction" << endl;
+		for (const Benchmark_Point& point : points) {
+			out << mode << "," << point.threads << "," << point.rows << "," << point.cols << "," << params.ticks << "," << params.repeats << ","
+				<< point.mean << "," << point.stddev << "," << point.min << "," << point.max << "," << point.cell_updates << "," << point.speedup << "," << point.efficiency << "," << point.idle << endl;
+		}
+		return;
+	}
+	out << "{" << endl;
+	out << "  \"benchmark\": \"" << mode << "\"," << endl;
+	out << "  \"ticks\": " << params.ticks << "," << endl;
+	out << "  \"repeats\": " << params.repeats << "," << endl;
+	out << "  \"seed\": " << params.seed << "," << endl;
+	out << "  \"schedule\": \"" << (params.schedule == Schedule::Tiles ? "tiles" : "rows") << "\"," << endl;
+	out << "  \"tile_size\": " << params.tile_size << "," << endl;
+	out << "  \"layout\": \"" << (params.layout == Grid_Layout::Morton ? "morton" : "rows") << "\"," << endl;
+	out << "  \"points\": [" << endl;
+	for (size_t p = 0; p < points.size(); ++p) {
+		const Benchmark_Point& point = points[p];
+		out << "    { \"threads\": " << point.threads << ", \"rows\": " << point.rows << ", \"cols\": " << point.cols
+			<< ", \"ticks_per_second\": " << point.mean << ", \"ticks_per_second_stddev\": " << point.stddev
+			<< ", \"ticks_per_second_min\": " << point.min << ", \"ticks_per_second_max\": " << point.max
+			<< ", \"cell_updates_per_second\": " << point.cell_updates << ", \"speedup\": " << point.speedup << ", \"efficiency\": " << point.efficiency
+			<< ", \"idle_fraction\": " << point.idle << ", \"seconds\": [";
+		for (size_t r = 0; r < point.seconds.size(); ++r) {
+			out << (r ? ", " : "") << point.seconds[r];
+		}
+		out << "] }" << (p + 1 < points.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file Neighbors.cpp
+ * @brief Microbenchmark: vecinos en un vector del heap (forma anterior) contra vecinos en la pila.
+ *
+ * Compilar desde MicroProyecto/:
+ *   g++ -std=c++20 -O2 -fopenmp Benchmarks/Neighbors.cpp -o bench_neighbors
+ * Uso:
+ *   ./bench_neighbors [lado de la cuadrícula] [ticks]
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "../Simulation.hpp"
+
+using namespace std;
+
+/** Llamadas al asignador de memoria desde el inicio del programa. */
+static atomic<size_t> allocations = 0;
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	if (void* pointer = malloc(size ? size : 1)) {
+		return pointer;
+	}
+	throw bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	free(pointer);
+}
+
+/**
+ * @brief Permutación aleatoria de las 8 direcciones a partir de un sorteo.
+ *
+ * Fisher-Yates con los dígitos del sorteo en base factorial (8! < 2^32); las divisiones son por
+ * constantes y el compilador desenrolla el bucle.
+ * @param shuffle Sorteo de 32 bits.
+ * @return Direcciones (índices de moore_offsets) en orden aleatorio.
+ */
+inline array<uint8_t, 8> shuffled_directions(uint32_t shuffle) {
+	array<uint8_t, 8> order = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	for (uint32_t i = 7; i > 0; --i) {
+		const uint32_t j = shuffle % (i + 1);
+		shuffle /= (i + 1);
+		swap(order[i], order[j]);
+	}
+	return order;
+}
+
+/**
+ * @struct Vector_Neighbors
+ * @brief Mismos vecinos y mismo orden que Moore_Neighbors, guardados en un vector en el heap.
+ *
+ * Es la forma anterior de get_neighbors, con el orden de shuffled_directions() y sin vecinos fuera de
+ * la cuadrícula. La simulación ya no la usa; solo sirve de referencia para este benchmark.
+ */
+struct Vector_Neighbors {
+	vector<size_t> indices;      /**< Índices lineales de los vecinos. */
+	vector<uint8_t> directions;  /**< Dirección (índice de moore_offsets) de cada vecino. */
+	int x;                       /**< Fila de la célula. */
+	int y;                       /**< Columna de la célula. */
+
+	template<typename Grid_Type>
+	Vector_Neighbors(const Grid_Type& grid, const int& x, const int& y, const uint32_t& shuffle): x(x), y(y) {
+		const array<uint8_t, 8> order = shuffled_directions(shuffle);
+		for (int i = 0; i < 8; ++i) {
+			const Offset& offset = moore_offsets[order[i]];
+			const int nx = x + offset.dx;
+			const int ny = y + offset.dy;
+			if (nx >= 0 && nx < grid.rows && ny >= 0 && ny < grid.cols) {
+				indices.emplace_back(grid.index(nx, ny));
+				directions.emplace_back(order[i]);
+			}
+		}
+	}
+
+	/** @copydoc Moore_Neighbors::first */
+	int first(const uint8_t& mask) const {
+		for (size_t i = 0; i < indices.size(); ++i) {
+			if ((mask >> directions[i]) & 1u) {
+				return directions[i];
+			}
+		}
+		return -1;
+	}
+
+	/** @copydoc Moore_Neighbors::index */
+	template<typename Grid_Type>
+	size_t index(const Grid_Type& grid, const int& direction) const {
+		for (size_t i = 0; i < indices.size(); ++i) {
+			if (directions[i] == direction) {
+				return indices[i];
+			}
+		}
+		const Offset& offset = moore_offsets[direction];
+		return grid.index(x + offset.dx, y + offset.dy);  // Fuera de la cuadrícula: el relleno.
+	}
+};
+
+/**
+ * @struct Result
+ * @brief Resultado de una corrida del benchmark.
+ */
+struct Result {
+	double ticks_per_second;    /**< Ticks por segundo. */
+	double allocations_per_tick; /**< Llamadas a operator new por tick. */
+	vector<Cell> cells;         /**< Células al final, para comprobar que ambas formas coinciden. */
+};
+
+/**
+ * @brief Corre la simulación con una lista de vecinos dada.
+ * @param params Parámetros de la corrida.
+ * @tparam Neighbors Lista de vecinos usada por update_cell.
+ */
+template<typename Neighbors>
+Result run(const Parameters& params) {
+	Ecosystem ecosystem(params);
+	Result result;
+	with_rules(params.species, [&](const auto& rules) {
+		initialize_grid(ecosystem, rules);
+
+		const size_t allocations_before = allocations.load();
+		const auto start = chrono::steady_clock::now();
+		#pragma omp parallel num_threads(params.threads)
+		{
+			ecosystem.planes.build(ecosystem.grid);
+			for (int tick = 0; tick < params.ticks; ++tick) {
+				advance<Neighbors>(ecosystem, tick, rules);
+			}
+		}
+		const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		const size_t allocations_after = allocations.load();
+
+		result = { params.ticks / elapsed.count(), double(allocations_after - allocations_before) / params.ticks, { ecosystem.grid.current().begin(), ecosystem.grid.current().end() } };
+	});
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+	Parameters params;
+	params.rows = params.cols = argc > 1 ? atoi(argv[1]) : 1000;
+	params.ticks = argc > 2 ? atoi(argv[2]) : 20;
+
+	const Result heap = run<Vector_Neighbors>(params);
+	const Result stack = run<Moore_Neighbors>(params);
+
+	cout << "Grid " << params.rows << "x" << params.cols << ", " << params.ticks << " ticks, " << params.threads << " threads" << endl;
+	cout << "Vector_Neighbors: " << heap.ticks_per_second << " ticks/s, " << heap.allocations_per_tick << " allocations/tick" << endl;
+	cout << "Moore_Neighbors:  " << stack.ticks_per_second << " ticks/s, " << stack.allocations_per_tick << " allocations/tick" << endl;
+	cout << "Speedup: " << stack.ticks_per_second / heap.ticks_per_second << "x" << endl;
+	cout << "Same result: " << (heap.cells == stack.cells ? "yes" : "no") << endl;
+	return heap.cells == stack.cells ? 0 : 1;
+}
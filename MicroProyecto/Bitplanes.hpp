@@ -0,0 +1,226 @@
+#pragma once
+
+/**
+ * @file Bitplanes.hpp
+ * @brief Planos de bits por especie para consultar la ocupación de los vecinos sin leer las células.
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Neighbors.hpp"
+
+using namespace std;
+
+/**
+ * @struct Neighborhood
+ * @brief Resumen del vecindario de una célula en el búfer actual: un bit por dirección de moore_offsets.
+ *
+ * Las direcciones que salen de la cuadrícula nunca tienen el bit encendido.
+ */
+struct Neighborhood {
+	uint8_t empty;      /**< Vecinos vacíos. */
+	uint8_t plant;      /**< Vecinos con planta. */
+	uint8_t herbivore;  /**< Vecinos con herbívoro. */
+};
+
+/**
+ * @struct Neighbor_Words
+ * @brief Ocupación de una especie alrededor de 64 células consecutivas de una fila.
+ *
+ * El bit k de direction[d] indica si el vecino en la dirección d de la célula k tiene la especie.
+ */
+struct Neighbor_Words {
+	array<uint64_t, 8> direction;  /**< Una palabra por dirección de moore_offsets. */
+
+	/** @return Máscara de 8 bits (una por dirección) de la célula k. */
+	uint8_t mask(const int& k) const {
+		uint32_t mask = 0;
+		for (int d = 0; d < 8; ++d) {
+			mask |= uint32_t((direction[d] >> k) & 1u) << d;
+		}
+		return uint8_t(mask);
+	}
+};
+
+/**
+ * @struct Bitplanes
+ * @brief Un plano de bits por especie, con una fila y una columna de relleno a cada lado.
+ *
+ * La célula (x, y) está en la fila x + 1, bit y + 1 del plano. Con bordes cerrados el relleno vale 0;
+ * con Border::Torus wrap_edges() copia en él la fila o columna del borde opuesto. Así las consultas cerca
+ * del borde no necesitan comprobar límites, y cada fila tiene palabras de sobra para leer 64 bits a partir
+ * de cualquier columna.
+ */
+struct Bitplanes {
+	int rows;       /**< Filas de la cuadrícula. */
+	int cols;       /**< Columnas de la cuadrícula. */
+	int row_words;  /**< Palabras de 64 bits por fila del plano. */
+	bool torus;     /**< El relleno repite el borde opuesto (Border::Torus). */
+	array<Paged_Array<uint64_t>, 4> planes;  /**< Un plano por especie, indexado por Species. */
+
+	/**
+	 * @brief Reserva los planos para una cuadrícula.
+	 * @param grid Cuadrícula de la que se toman las dimensiones.
+	 * @param torus El relleno repite el borde opuesto.
+	 * @param storage Directorio de los archivos mapeados de los planos; vacío = en el heap.
+	 * @param threads Hilos que tocan primero las páginas (ver Paged_Array).
+	 */
+	template<typename Grid_Type>
+	explicit Bitplanes(const Grid_Type& grid, const bool& torus = false, const string& storage = "", const int& threads = 1): rows(grid.rows), cols(grid.cols), row_words((grid.cols + 2) / 64 + 3), torus(torus) {
+		for (Paged_Array<uint64_t>& plane : planes) {
+			plane.assign(size_t(rows + 2) * row_words, 0, storage, threads);
+		}
+	}
+
+	/**
+	 * @brief Pide al disco las filas [x0, x1) de los planos, si viven en archivos mapeados.
+	 * @param x0 Primera fila (desde -1).
+	 * @param x1 Fila siguiente a la última (hasta rows + 1).
+	 */
+	void prefetch_rows(const int& x0, const int& x1) const {
+		const int first = max(x0, -1) + 1;
+		const int last = min(x1, rows + 1) + 1;
+		if (first < last) {
+			for (const Paged_Array<uint64_t>& plane : planes) {
+				plane.prefetch(size_t(first) * row_words, size_t(last - first) * row_words);
+			}
+		}
+	}
+
+	/**
+	 * @brief Reconstruye los planos a partir del búfer actual. Debe llamarse desde todos los hilos de una región omp parallel.
+	 * @param grid Cuadrícula de la que se leen las especies.
+	 */
+	template<typename Grid_Type>
+	void build(const Grid_Type& grid) {
+		#pragma omp for
+		for (int x = 0; x < rows; ++x) {
+			build_span(grid, x, 0, cols);
+		}
+		wrap_edges();
+	}
+
+	/**
+	 * @brief Con Border::Torus, copia al relleno las columnas y filas del borde opuesto; si no, no hace nada.
+	 *
+	 * Debe llamarse desde todos los hilos de una región omp parallel, después de reconstruir las filas.
+	 */
+	void wrap_edges() {
+		if (!torus) {
+			return;
+		}
+		#pragma omp for
+		for (int x = 0; x < rows; ++x) {
+			for (Paged_Array<uint64_t>& plane : planes) {
+				uint64_t* row = plane.data() + size_t(x + 1) * row_words;
+				copy_bit(row, cols, 0);
+				copy_bit(row, 1, cols + 1);
+			}
+		}
+		#pragma omp for
+		for (int s = 0; s < 4; ++s) {
+			uint64_t* plane = planes[s].data();
+			copy(plane + size_t(rows) * row_words, plane + size_t(rows + 1) * row_words, plane);
+			copy(plane + size_t(1) * row_words, plane + size_t(2) * row_words, plane + size_t(rows + 1) * row_words);
+		}
+	}
+
+	/**
+	 * @brief Reconstruye un tramo de una fila a partir del búfer actual.
+	 *
+	 * Las palabras de una fila se comparten entre tramos: solo un hilo a la vez debe reconstruir cada fila.
+	 * @param grid Cuadrícula de la que se leen las especies.
+	 * @param x Fila del tramo.
+	 * @param y0 Primera columna.
+	 * @param y1 Columna siguiente a la última.
+	 */
+	template<typename Grid_Type>
+	void build_span(const Grid_Type& grid, const int& x, const int& y0, const int& y1) {
+		uint64_t* row[4];
+		for (int s = 0; s < 4; ++s) {
+			row[s] = planes[s].data() + size_t(x + 1) * row_words;
+		}
+		grid.for_each_run(x, y0, y1, [&](const size_t& n, const int& first, const int& count) {
+			const Cell* line = grid.current().data() + n - first;
+			for (int y = first; y < first + count; ++y) {
+				const int bit = y + 1;
+				const uint64_t mask = uint64_t(1) << (bit & 63);
+				for (int s = 0; s < 4; ++s) {
+					row[s][bit >> 6] &= ~mask;
+				}
+				row[int(line[y].species())][bit >> 6] |= mask;
+			}
+		});
+	}
+
+	/**
+	 * @brief Lee 64 bits de un plano a partir de una columna.
+	 * @param species Especie del plano.
+	 * @param x Fila (de -1 a rows).
+	 * @param y Primera columna (desde -1).
+	 * @return Bit k: la célula (x, y + k) tiene la especie.
+	 */
+	uint64_t bits64(const Species& species, const int& x, const int& y) const {
+		const uint64_t* row = planes[int(species)].data() + size_t(x + 1) * row_words;
+		const int bit = y + 1;
+		const int word = bit >> 6;
+		const int shift = bit & 63;
+		return (row[word] >> shift) | ((row[word + 1] << 1) << (63 - shift));
+	}
+
+	/**
+	 * @brief Ocupación de una especie alrededor de 64 células consecutivas, con desplazamientos de palabras completas.
+	 * @param species Especie a consultar.
+	 * @param x Fila de las células.
+	 * @param y Primera columna de las células.
+	 */
+	Neighbor_Words neighbor_words(const Species& species, const int& x, const int& y) const {
+		Neighbor_Words words;
+		for (int d = 0; d < 8; ++d) {
+			words.direction[d] = bits64(species, x + moore_offsets[d].dx, y + moore_offsets[d].dy);
+		}
+		return words;
+	}
+
+	/**
+	 * @brief Resumen del vecindario de una sola célula.
+	 * @param x Fila de la célula.
+	 * @param y Columna de la célula.
+	 */
+	Neighborhood neighborhood(const int& x, const int& y) const {
+		return {
+			neighbor_words(Species::Empty, x, y).mask(0),
+			neighbor_words(Species::Plant, x, y).mask(0),
+			neighbor_words(Species::Herbivore, x, y).mask(0)
+		};
+	}
+
+	/**
+	 * @brief Cuenta las células de una especie con popcount (sin el relleno).
+	 * @param species Especie a contar.
+	 */
+	size_t count(const Species& species) const {
+		size_t total = 0;
+		for (int x = 0; x < rows; ++x) {
+			const uint64_t* row = planes[int(species)].data() + size_t(x + 1) * row_words;
+			for (int w = 0; w < row_words; ++w) {
+				total += size_t(popcount(row[w]));
+			}
+			total -= (row[0] & 1u) + ((row[(cols + 1) >> 6] >> ((cols + 1) & 63)) & 1u);
+		}
+		return total;
+	}
+
+private:
+	/** @brief Copia el bit from de una fila del plano al bit to. */
+	static void copy_bit(uint64_t* row, const int& from, const int& to) {
+		const uint64_t bit = (row[from >> 6] >> (from & 63)) & 1u;
+		row[to >> 6] = (row[to >> 6] & ~(uint64_t(1) << (to & 63))) | (bit << (to & 63));
+	}
+};
@@ -0,0 +1,389 @@
+#pragma once
+
+/**
+ * @file Checkpoint.hpp
+ * @brief Puntos de control binarios: escritura asíncrona del búfer retirado en el intercambio y restauración con mmap.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Grid.hpp"
+#include "Parameters.hpp"
+#include "Simulation.hpp"
+
+using namespace std;
+
+/**
+ * @struct Snapshot_Model
+ * @brief Parámetros que definen el modelo: con ellos, la semilla y el tick, una corrida se reanuda bit a bit.
+ *
+ * Los parámetros de ejecución (ticks, hilos, salida) no se guardan y se toman de la línea de comandos.
+ */
+struct Snapshot_Model {
+	int32_t rows;                /**< Filas de la cuadrícula. */
+	int32_t cols;                /**< Columnas de la cuadrícula. */
+	int32_t schedule;            /**< Schedule de la corrida. */
+	int32_t tile_size;           /**< Lado de los tiles. */
+	int32_t border;              /**< Border de la corrida. */
+	Species_Parameters species;  /**< Constantes de las especies. */
+};
+static_assert(is_trivially_copyable_v<Snapshot_Model>, "Snapshot_Model se escribe byte a byte");
+
+/**
+ * @struct Snapshot_Header
+ * @brief Encabezado de un punto de control (versión 1).
+ *
+ * Diseño del archivo: encabezado, Snapshot_Model y, desde cells_offset (alineado a página), las
+ * células de grid.current() en el orden de Row_Major_Layout, con su anillo de relleno: el tramo es
+ * un búfer de Grid tal cual y se puede proyectar como tal (ver Snapshot_Reader::grid). Las plantas
+ * guardan su tick de nacimiento (ver Cell::plant_age), que sigue valiendo al reanudar desde tick.
+ */
+struct Snapshot_Header {
+	static constexpr char expected_magic[8] = { 'E', 'C', 'O', 'S', 'N', 'A', 'P', '\0' };  /**< Firma del formato. */
+	static constexpr uint32_t current_version = 1;  /**< Versión que escribe este código. */
+	static constexpr uint64_t alignment = 4096;     /**< Alineación de las células en el archivo. */
+
+	char magic[8];            /**< expected_magic. */
+	uint32_t version;         /**< Versión del formato. */
+	uint32_t header_bytes;    /**< sizeof(Snapshot_Header). */
+	uint32_t model_bytes;     /**< sizeof(Snapshot_Model): cambia si cambia Species_Parameters. */
+	uint32_t cell_bytes;      /**< sizeof(Cell). */
+	uint64_t rng_seed;        /**< Semilla de Philox; el contador de cada sorteo sale de la célula y el tick. */
+	int64_t tick;             /**< Ticks completados. */
+	uint64_t cells_offset;    /**< Posición de la primera célula. */
+	uint64_t cells_count;     /**< (rows + 2) * (cols + 2), relleno incluido. */
+};
+static_assert(is_trivially_copyable_v<Snapshot_Header>, "Snapshot_Header se escribe byte a byte");
+
+/**
+ * @struct Checkpoint_Writer
+ * @brief Guarda puntos de control sin detener el bucle de ticks ni copiar la cuadrícula.
+ *
+ * capture() no copia células: deja un búfer de repuesto en ecosystem.retire y el intercambio del tick
+ * siguiente lo cambia por el búfer que deja de ser actual, que todavía tiene el estado del punto de
+ * control (las plantas con su tick de nacimiento, que vale en cualquier tick). collect() le pasa ese
+ * búfer a un hilo aparte, que lo escribe en el orden de Row_Major_Layout a un archivo temporal que
+ * luego reemplaza al anterior, y que después vuelve a ser el de repuesto. El repuesto se reserva como
+ * los búferes de la cuadrícula (en el heap o, con params.storage, en un archivo mapeado). Si la
+ * escritura anterior no terminó, el punto de control se salta. El último se escribe directamente
+ * desde grid.current(), que ya no cambia.
+ */
+struct Checkpoint_Writer {
+	/**
+	 * @brief Reserva el búfer de repuesto si la corrida guarda puntos de control cada params.checkpoint_every ticks.
+	 * @param ecosystem Ecosistema a guardar.
+	 */
+	template<typename Layout>
+	explicit Checkpoint_Writer(const Basic_Ecosystem<Layout>& ecosystem): path(ecosystem.params.checkpoint), busy(false), armed(false), skipped(0) {
+		const Parameters& params = ecosystem.params;
+		if (!path.empty() && params.checkpoint_every > 0) {
+			spare.assign(ecosystem.grid.layout.cells(), Cell::wall(), params.storage, params.threads);
+		}
+	}
+
+	~Checkpoint_Writer() { wait(); }
+
+	Checkpoint_Writer(const Checkpoint_Writer&) = delete;
+	Checkpoint_Writer& operator=(const Checkpoint_Writer&) = delete;
+
+	/**
+	 * @brief Guarda el estado actual del ecosistema. Debe llamarse desde todos los hilos de una región omp parallel, entre ticks.
+	 *
+	 * Sin last, el búfer actual se entrega en el próximo ecosystem.swap_grid() y collect() lo empieza
+	 * a escribir; con advance_block, ese tick debe avanzarse solo.
+	 * @param ecosystem Ecosistema a guardar.
+	 * @param last Es el último punto de control: espera a la escritura anterior en lugar de saltarse y escribe grid.current() sin esperar un intercambio.
+	 */
+	template<typename Layout>
+	void capture(Basic_Ecosystem<Layout>& ecosystem, const bool& last = false) {
+		#pragma omp single
+		{
+			if (last) {
+				ecosystem.retire = nullptr;  // Un punto de control pedido en este mismo tick se escribe aquí.
+				armed = false;
+				wait();
+				describe(ecosystem);
+				busy.store(true, memory_order_release);
+				writer = thread(&Checkpoint_Writer::write_file<Layout>, this, cref(ecosystem.grid), cref(ecosystem.grid.current()));
+			}
+			else if (busy.load(memory_order_acquire)) {
+				skipped++;
+			}
+			else {
+				wait();
+				describe(ecosystem);
+				busy.store(true, memory_order_release);
+				armed = true;
+				ecosystem.retire = &spare;
+			}
+		}
+	}
+
+	/**
+	 * @brief Empieza a escribir el búfer que entregó el último intercambio, si capture() pidió uno. Debe llamarse desde todos los hilos de una región omp parallel, después de cada tick.
+	 * @param ecosystem Ecosistema pasado a capture().
+	 */
+	template<typename Layout>
+	void collect(const Basic_Ecosystem<Layout>& ecosystem) {
+		#pragma omp single
+		if (armed && !ecosystem.retire) {
+			armed = false;
+			writer = thread(&Checkpoint_Writer::write_file<Layout>, this, cref(ecosystem.grid), cref(spare));
+		}
+	}
+
+	/** @brief Espera a que termine la escritura en curso. Llamar fuera de una región paralela o desde un solo hilo. */
+	void wait() {
+		if (writer.joinable()) {
+			writer.join();
+		}
+	}
+
+	/** @return Puntos de control saltados porque la escritura anterior seguía en curso. */
+	int skipped_count() const { return skipped; }
+
+private:
+	string path;                 /**< Archivo de destino. */
+	Snapshot_Header header;      /**< Encabezado del punto de control en curso. */
+	Snapshot_Model model;        /**< Modelo del punto de control en curso. */
+	Grid_Buffer spare;           /**< Búfer de repuesto: entra a la cuadrícula en el intercambio y sale con el estado a escribir. */
+	thread writer;               /**< Hilo escritor. */
+	atomic<bool> busy;           /**< Hay un punto de control pedido o escribiéndose. */
+	bool armed;                  /**< capture() dejó spare en ecosystem.retire y collect() todavía no lo escribe. */
+	int skipped;                 /**< Puntos de control saltados. */
+
+	/** @brief Llena el encabezado y el modelo a partir del ecosistema. */
+	template<typename Layout>
+	void describe(const Basic_Ecosystem<Layout>& ecosystem) {
+		const Parameters& params = ecosystem.params;
+		header = {};
+		memcpy(header.magic, Snapshot_Header::expected_magic, sizeof(header.magic));
+		header.version = Snapshot_Header::current_version;
+		header.header_bytes = sizeof(Snapshot_Header);
+		header.model_bytes = sizeof(Snapshot_Model);
+		header.cell_bytes = sizeof(Cell);
+		header.rng_seed = params.seed;
+		header.tick = ecosystem.tick;
+		const uint64_t used = sizeof(Snapshot_Header) + sizeof(Snapshot_Model);
+		header.cells_offset = (used + Snapshot_Header::alignment - 1) / Snapshot_Header::alignment * Snapshot_Header::alignment;
+		header.cells_count = Row_Major_Layout(params.rows, params.cols).cells();
+		model = {};
+		model.rows = params.rows;
+		model.cols = params.cols;
+		model.schedule = int32_t(params.schedule);
+		model.tile_size = params.tile_size;
+		model.border = int32_t(params.border);
+		model.species = params.species;
+	}
+
+	/**
+	 * @brief Cuerpo del hilo escritor: archivo temporal y luego reemplazo del destino.
+	 * @param grid Cuadrícula de la que sale el orden de las células en cells.
+	 * @param cells Búfer a escribir, que nadie modifica hasta que termina.
+	 */
+	template<typename Layout>
+	void write_file(const Basic_Grid<Layout>& grid, const Grid_Buffer& cells) {
+		const string temporary = path + ".tmp";
+		bool ok = false;
+		if (FILE* file = fopen(temporary.c_str(), "wb")) {
+			const vector<char> padding(header.cells_offset - sizeof(Snapshot_Header) - sizeof(Snapshot_Model), 0);
+			const vector<Cell> walls(size_t(grid.cols) + 2, Cell::wall());  // El relleno se escribe siempre como pared.
+			ok = fwrite(&header, sizeof(header), 1, file) == 1
+				&& fwrite(&model, sizeof(model), 1, file) == 1
+				&& fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+			for (int x = -1; ok && x <= grid.rows; ++x) {
+				if (x < 0 || x == grid.rows) {
+					ok = fwrite(walls.data(), sizeof(Cell), walls.size(), file) == walls.size();
+					continue;
+				}
+				ok = fwrite(walls.data(), sizeof(Cell), 1, file) == 1;
+				grid.for_each_run(x, 0, grid.cols, [&](const size_t& n, const int&, const int& count) {
+					ok = ok && fwrite(cells.data() + n, sizeof(Cell), size_t(count), file) == size_t(count);
+				});
+				ok = ok && fwrite(walls.data(), sizeof(Cell), 1, file) == 1;
+			}
+			ok &= fclose(file) == 0;
+		}
+		if (ok) {
+			error_code error;
+			filesystem::rename(temporary, path, error);
+			ok = !error;
+		}
+		if (!ok) {
+			cerr << "Cannot write checkpoint: " << path << endl;
+		}
+		busy.store(false, memory_order_release);
+	}
+};
+
+/**
+ * @struct Snapshot_Reader
+ * @brief Punto de control abierto para reanudar una corrida: el archivo se proyecta en memoria con mmap.
+ *
+ * Con Row_Major_Layout en RAM, las células no se copian: los dos búferes de la cuadrícula son
+ * proyecciones privadas del tramo de células (ver Paged_Array::map_copy) y cada página se lee del
+ * disco la primera vez que se toca. En los demás casos (--storage, Morton_Layout o sin mmap) se copian
+ * en paralelo a una cuadrícula nueva.
+ */
+struct Snapshot_Reader {
+	Snapshot_Header header;  /**< Encabezado leído. */
+	Snapshot_Model model;    /**< Modelo leído. */
+
+	Snapshot_Reader(): header{}, model{} {}
+	~Snapshot_Reader() { unmap(); }
+
+	Snapshot_Reader(const Snapshot_Reader&) = delete;
+	Snapshot_Reader& operator=(const Snapshot_Reader&) = delete;
+
+	/**
+	 * @brief Proyecta el archivo y comprueba el encabezado.
+	 * @param path Archivo del punto de control.
+	 * @return false (tras imprimir el motivo) si no se puede abrir o no es un punto de control válido.
+	 */
+	bool open(const string& path) {
+		this->path = path;
+		if (!map(path)) {
+			cerr << "Cannot open checkpoint: " << path << endl;
+			return false;
+		}
+		if (size < sizeof(Snapshot_Header)) {
+			cerr << "Invalid checkpoint (truncated header): " << path << endl;
+			return false;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, Snapshot_Header::expected_magic, sizeof(header.magic)) != 0) {
+			cerr << "Invalid checkpoint (not a snapshot): " << path << endl;
+			return false;
+		}
+		if (header.version != Snapshot_Header::current_version || header.header_bytes != sizeof(Snapshot_Header) || header.model_bytes != sizeof(Snapshot_Model) || header.cell_bytes != sizeof(Cell)) {
+			cerr << "Invalid checkpoint (version " << header.version << " or layout not supported by this build): " << path << endl;
+			return false;
+		}
+		memcpy(&model, data + sizeof(Snapshot_Header), sizeof(model));
+		if (model.rows <= 0 || model.cols <= 0 || header.cells_count != uint64_t(model.rows + 2) * uint64_t(model.cols + 2) || header.cells_offset + header.cells_count * sizeof(Cell) > size) {
+			cerr << "Invalid checkpoint (truncated cells): " << path << endl;
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Reemplaza los parámetros del modelo por los del punto de control.
+	 * @param params Parámetros de la corrida; se conservan los de ejecución.
+	 */
+	void apply(Parameters& params) const {
+		params.rows = model.rows;
+		params.cols = model.cols;
+		params.schedule = Schedule(model.schedule);
+		params.tile_size = model.tile_size;
+		params.border = Border(model.border);
+		params.seed = header.rng_seed;
+		params.species = model.species;
+	}
+
+	/**
+	 * @brief Cuadrícula con las células del punto de control. Llamar fuera de una región paralela.
+	 * @param params Parámetros de la corrida, después de apply().
+	 * @return Los búferes proyectados del archivo si se puede (ver la descripción de la estructura); si no, una cuadrícula nueva con las células copiadas.
+	 */
+	template<typename Layout>
+	Basic_Grid<Layout> grid(const Parameters& params) const {
+		if constexpr (is_same_v<Layout, Row_Major_Layout>) {
+			Grid_Buffer current, next;
+			if (params.storage.empty() && current.map_copy(path, header.cells_offset, header.cells_count) && next.map_copy(path, header.cells_offset, header.cells_count)) {
+				return Basic_Grid<Layout>(params.rows, params.cols, move(current), move(next));
+			}
+		}
+		Basic_Grid<Layout> grid(params.rows, params.cols, 0, params.storage, params.threads);
+		const Row_Major_Layout file_layout(params.rows, params.cols);
+		const Cell* cells = reinterpret_cast<const Cell*>(data + header.cells_offset);
+		for (Grid_Buffer* buffer : { &grid.current(), &grid.next() }) {
+			#pragma omp parallel for num_threads(params.threads)
+			for (int i = 0; i < grid.rows; ++i) {
+				grid.for_each_run(i, 0, grid.cols, [&](const size_t& n, const int& y, const int& count) {
+					memcpy(buffer->data() + n, cells + file_layout.index(i, y), sizeof(Cell) * count);
+				});
+			}
+		}
+		return grid;
+	}
+
+	/**
+	 * @brief Recupera el tick y los conteos. Llamar fuera de una región paralela.
+	 * @param ecosystem Ecosistema creado sobre grid().
+	 */
+	template<typename Layout>
+	void load(Basic_Ecosystem<Layout>& ecosystem) const {
+		ecosystem.tick = int(header.tick);
+		ecosystem.stats.start(ecosystem.grid, ecosystem.tick);
+	}
+
+private:
+	string path;                 /**< Archivo del punto de control. */
+	const char* data = nullptr;  /**< Contenido del archivo. */
+	size_t size = 0;             /**< Bytes del archivo. */
+#ifdef _WIN32
+	vector<char> contents;       /**< Sin mmap: el archivo leído completo. */
+#endif
+
+	/** @brief Proyecta (o, sin mmap, lee) el archivo completo. */
+	bool map(const string& path) {
+#ifdef _WIN32
+		ifstream file(path, ios::binary);
+		if (!file) {
+			return false;
+		}
+		contents.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+		data = contents.data();
+		size = contents.size();
+		return true;
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapping == MAP_FAILED) {
+			return false;
+		}
+		data = static_cast<const char*>(mapping);
+		size = size_t(info.st_size);
+		return true;
+#endif
+	}
+
+	/** @brief Libera la proyección. */
+	void unmap() {
+#ifndef _WIN32
+		if (data) {
+			munmap(const_cast<char*>(data), size);
+		}
+#endif
+		data = nullptr;
+		size = 0;
+	}
+};
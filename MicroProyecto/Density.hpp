@@ -0,0 +1,247 @@
+#pragma once
+
+/**
+ * @file Density.hpp
+ * @brief Tablas de sumas acumuladas por especie: cuántas células de cada especie hay en cualquier rectángulo, en O(1).
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include "Bitplanes.hpp"
+#include "Grid.hpp"
+#include "Parameters.hpp"
+
+using namespace std;
+
+/**
+ * @struct Density_Tables
+ * @brief Tablas de área sumada (summed-area tables) de plantas, herbívoros y carnívoros.
+ *
+ * La entrada (x, y) cuenta las células de las filas [0, x) y las columnas [0, y), así que un rectángulo
+ * se resuelve con cuatro entradas. Las tres especies de una entrada van juntas, en la misma línea de
+ * caché. Se reconstruyen desde los planos de bits en una pasada paralela por bloques de columnas, uno
+ * o más por hilo.
+ */
+struct Density_Tables {
+	/** Conteos de una entrada, indexados por especie - 1 (Plant, Herbivore, Carnivore). */
+	using Entry = array<uint32_t, 3>;
+
+	/** Columnas mínimas de un bloque (16 entradas son 3 líneas de caché): el ancho es múltiplo de este. */
+	static constexpr int min_block_cols = 16;
+
+	int rows;              /**< Filas de la cuadrícula. */
+	int cols;              /**< Columnas de la cuadrícula. */
+	vector<Entry> sums;    /**< (rows + 1) x (cols + 1) entradas; la fila y la columna 0 valen 0. */
+
+	/**
+	 * @brief Reserva las tablas de una cuadrícula.
+	 * @param rows Filas de la cuadrícula.
+	 * @param cols Columnas de la cuadrícula.
+	 */
+	Density_Tables(const int& rows, const int& cols): rows(rows), cols(cols), sums(size_t(rows + 1) * (cols + 1), Entry{}) {}
+
+	/**
+	 * @brief Reconstruye las tablas desde los planos de bits. Debe llamarse desde todos los hilos de una región omp parallel.
+	 *
+	 * Las columnas se parten en un bloque por hilo (block_width) y cada hilo baja el suyo fila por fila:
+	 * la entrada es la de arriba más la suma de la fila hasta esa columna, que arranca con un popcount de
+	 * las palabras a la izquierda del bloque. Así cada entrada se escribe una sola vez, la fila de arriba
+	 * todavía está en caché y todos los hilos trabajan aunque la cuadrícula sea angosta.
+	 * @param planes Planos de bits del búfer actual.
+	 */
+	void build(const Bitplanes& planes) {
+		const size_t width = size_t(cols) + 1;
+		const int block_cols = block_width(omp_get_num_threads());
+		#pragma omp for schedule(static)
+		for (int y0 = 0; y0 < cols; y0 += block_cols) {
+			const int y1 = min(y0 + block_cols, cols);
+			for (int x = 0; x < rows; ++x) {
+				const Entry* above = sums.data() + size_t(x) * width;
+				Entry* row = sums.data() + size_t(x + 1) * width;
+				const uint64_t* words[3];
+				Entry running;
+				for (int s = 0; s < 3; ++s) {
+					words[s] = planes.planes[s + 1].data() + size_t(x + 1) * planes.row_words;
+					running[s] = count_bits(words[s], y0 + 1);
+				}
+				for (int y = y0; y < y1; ++y) {
+					const int bit = y + 1;
+					for (int s = 0; s < 3; ++s) {
+						running[s] += uint32_t((words[s][bit >> 6] >> (bit & 63)) & 1u);
+						row[y + 1][s] = above[y + 1][s] + running[s];
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Células de cada especie en un rectángulo, en O(1).
+	 * @param x0 Primera fila.
+	 * @param y0 Primera columna.
+	 * @param x1 Fila siguiente a la última.
+	 * @param y1 Columna siguiente a la última.
+	 * @return Conteos indexados por Species; las vacías son el resto del área.
+	 */
+	array<int64_t, 4> count(const int& x0, const int& y0, const int& x1, const int& y1) const {
+		const size_t width = size_t(cols) + 1;
+		const Entry& a = sums[size_t(x0) * width + y0];
+		const Entry& b = sums[size_t(x0) * width + y1];
+		const Entry& c = sums[size_t(x1) * width + y0];
+		const Entry& d = sums[size_t(x1) * width + y1];
+		array<int64_t, 4> counts;
+		counts[int(Species::Empty)] = int64_t(x1 - x0) * (y1 - y0);
+		for (int s = 0; s < 3; ++s) {
+			counts[s + 1] = int64_t(d[s]) - b[s] - c[s] + a[s];
+			counts[int(Species::Empty)] -= counts[s + 1];
+		}
+		return counts;
+	}
+
+private:
+	/** @return Columnas de cada bloque de build(): cols entre los hilos, redondeado a min_block_cols. */
+	int block_width(const int& threads) const {
+		const int share = (cols + threads - 1) / threads;
+		return (max(share, 1) + min_block_cols - 1) / min_block_cols * min_block_cols;
+	}
+
+	/** @return Bits encendidos de una fila de un plano en las posiciones [1, end), es decir, en las columnas [0, end - 1). */
+	static uint32_t count_bits(const uint64_t* words, const int& end) {
+		uint32_t count = 0;
+		for (int w = 0; w < end >> 6; ++w) {
+			count += uint32_t(popcount(words[w]));
+		}
+		count += uint32_t(popcount(words[end >> 6] & ((uint64_t(1) << (end & 63)) - 1)));
+		return count - uint32_t(words[0] & 1u);  // El bit 0 es el relleno de la columna -1.
+	}
+};
+
+/**
+ * @struct Zone
+ * @brief Rectángulo con nombre de la cuadrícula (una zona de hábitat).
+ */
+struct Zone {
+	string name;  /**< Nombre de la zona. */
+	int x0;       /**< Primera fila. */
+	int y0;       /**< Primera columna. */
+	int x1;       /**< Fila siguiente a la última. */
+	int y1;       /**< Columna siguiente a la última. */
+};
+
+/**
+ * @brief Lee las zonas de un archivo: una por línea, "nombre x0 y0 x1 y1" (filas [x0, x1), columnas [y0, y1)).
+ *
+ * '#' inicia un comentario y las líneas vacías se ignoran.
+ * @param path Ruta del archivo.
+ * @param rows Filas de la cuadrícula.
+ * @param cols Columnas de la cuadrícula.
+ * @param zones Zonas leídas.
+ * @return false si el archivo no se puede abrir o alguna zona es inválida o sale de la cuadrícula.
+ */
+inline bool load_zones(const string& path, const int& rows, const int& cols, vector<Zone>& zones) {
+	ifstream file(path);
+	if (!file) {
+		cerr << "Cannot open zones file: " << path << endl;
+		return false;
+	}
+	bool ok = true;
+	string line;
+	for (int number = 1; getline(file, line); ++number) {
+		line = line.substr(0, line.find('#'));
+		istringstream tokens(line);
+		Zone zone;
+		if (!(tokens >> zone.name)) continue;
+		string extra;
+		if (!(tokens >> zone.x0 >> zone.y0 >> zone.x1 >> zone.y1) || (tokens >> extra)
+			|| zone.x0 < 0 || zone.y0 < 0 || zone.x0 >= zone.x1 || zone.y0 >= zone.y1 || zone.x1 > rows || zone.y1 > cols) {
+			cerr << path << ":" << number << ": invalid zone (expected \"name x0 y0 x1 y1\" inside the grid)" << endl;
+			ok = false;
+			continue;
+		}
+		zones.push_back(zone);
+	}
+	return ok;
+}
+
+/**
+ * @struct Density_Report
+ * @brief Conteos por zona en cada tick y mapa de densidad reducido, ambos en CSV, a partir de Density_Tables.
+ */
+struct Density_Report {
+	Density_Tables tables;  /**< Tablas del búfer actual. */
+	vector<Zone> zones;     /**< Zonas a contar en cada tick. */
+	ofstream zone_file;     /**< CSV de conteos por zona; cerrado si no hay zonas. */
+	ofstream heatmap_file;  /**< CSV del mapa de densidad; cerrado si no se pidió. */
+	int block = 16;         /**< Lado de los bloques del mapa de densidad. */
+
+	/** @brief Reporte vacío; open() lo prepara. */
+	Density_Report(): tables(0, 0) {}
+
+	/**
+	 * @brief Lee las zonas, abre los archivos de salida y reserva las tablas, si params pide zonas o mapa.
+	 * @param params Parámetros de la corrida, ya validados.
+	 * @return false (tras imprimir el motivo) si las zonas son inválidas o algún archivo no se puede abrir.
+	 */
+	bool open(const Parameters& params) {
+		block = params.heatmap_block;
+		if (!params.zones.empty()) {
+			if (!load_zones(params.zones, params.rows, params.cols, zones)) {
+				return false;
+			}
+			zone_file.open(params.zone_report);
+			if (!zone_file) {
+				cerr << "Cannot write zone report: " << params.zone_report << endl;
+				return false;
+			}
+			zone_file << "tick,zone,empty,plants,herbivores,carnivores" << '\n';
+		}
+		if (!params.heatmap.empty()) {
+			heatmap_file.open(params.heatmap);
+			if (!heatmap_file) {
+				cerr << "Cannot write heatmap: " << params.heatmap << endl;
+				return false;
+			}
+			heatmap_file << "tick,block_row,block_col,plants,herbivores,carnivores" << '\n';
+		}
+		if (enabled()) {
+			tables = Density_Tables(params.rows, params.cols);
+		}
+		return true;
+	}
+
+	/** @return Hay algo que escribir en cada tick. */
+	bool enabled() const { return zone_file.is_open() || heatmap_file.is_open(); }
+
+	/**
+	 * @brief Escribe los conteos de las zonas de un tick y, si frame, el mapa de densidad. Solo desde un hilo.
+	 * @param tick Ticks completados.
+	 * @param frame Escribir también el mapa de densidad.
+	 */
+	void write(const int& tick, const bool& frame) {
+		for (const Zone& zone : zones) {
+			const array<int64_t, 4> counts = tables.count(zone.x0, zone.y0, zone.x1, zone.y1);
+			zone_file << tick << ',' << zone.name << ',' << counts[0] << ',' << counts[1] << ',' << counts[2] << ',' << counts[3] << '\n';
+		}
+		if (!frame || !heatmap_file.is_open()) {
+			return;
+		}
+		for (int bx = 0; bx * block < tables.rows; ++bx) {
+			for (int by = 0; by * block < tables.cols; ++by) {
+				const int x0 = bx * block, x1 = min(x0 + block, tables.rows);
+				const int y0 = by * block, y1 = min(y0 + block, tables.cols);
+				const array<int64_t, 4> counts = tables.count(x0, y0, x1, y1);
+				const double area = double(x1 - x0) * (y1 - y0);
+				heatmap_file << tick << ',' << bx << ',' << by << ',' << counts[1] / area << ',' << counts[2] / area << ',' << counts[3] / area << '\n';
+			}
+		}
+	}
+};
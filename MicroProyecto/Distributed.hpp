@@ -0,0 +1,237 @@
+#pragma once
+
+/**
+ * @file Distributed.hpp
+ * @brief Corrida repartida en varios procesos: cada uno simula una franja de filas y un coordinador junta las estadísticas y los cuadros.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Halo.hpp"
+#include "Recorder.hpp"
+#include "Renderer.hpp"
+#include "Simulation.hpp"
+
+using namespace std;
+
+/** @brief Bytes de filas que el coordinador recibe de una franja antes de pasarlas al Frame_Renderer. */
+constexpr size_t rows_chunk_bytes = size_t(1) << 20;
+
+/**
+ * @brief Suma el registro de una franja al de toda la cuadrícula.
+ * @param total Registro de toda la cuadrícula.
+ * @param part Registro de una franja del mismo tick.
+ */
+inline void merge_record(Tick_Record& total, const Tick_Record& part) {
+	total.tick = part.tick;
+	for (int s = 0; s < 4; ++s) {
+		total.population[s] += part.population[s];
+		total.births[s] += part.births[s];
+		total.deaths[s] += part.deaths[s];
+		total.moves[s] += part.moves[s];
+		total.eaten[s] += part.eaten[s];
+	}
+}
+
+/**
+ * @brief Simula una franja y le envía al coordinador un registro por tick y sus filas en cada cuadro.
+ *
+ * Cada escritura en una fila de halo la cuenta el proceso que escribe, así que la suma de los registros
+ * de todas las franjas es el registro de la cuadrícula completa.
+ * @param ecosystem Franja, con ecosystem.halo conectado a sus vecinas.
+ * @param rules Reglas de las que salen las constantes.
+ * @param coordinator Socket con el coordinador.
+ * @return false si el coordinador o una franja vecina se desconectó.
+ */
+template<typename Rules>
+bool simulate_stripe(Ecosystem& ecosystem, const Rules& rules, const int& coordinator) {
+	const Parameters& params = ecosystem.params;
+	const Grid& grid = ecosystem.grid;
+	const auto send_rows = [&] {
+		const Cell* first = grid.current().data() + grid.index(ecosystem.phases.x_begin, -1);
+		return send_all(coordinator, first, size_t(ecosystem.phases.x_end - ecosystem.phases.x_begin) * grid.layout.stride * sizeof(Cell));
+	};
+	initialize_grid(ecosystem, rules);
+	Tick_Record record = ecosystem.stats.latest();
+	bool connected = send_all(coordinator, &record, sizeof(record));
+
+	#pragma omp parallel num_threads(params.threads)
+	{
+		ecosystem.planes.build(ecosystem.grid);
+		for (int tick = 0; tick < params.ticks; ++tick) {
+			advance(ecosystem, tick, rules);
+			if (ecosystem.halo_lost) {
+				break;
+			}
+			#pragma omp master
+			{
+				record = ecosystem.stats.latest();
+				connected = connected && send_all(coordinator, &record, sizeof(record));
+				if (tick % params.tick_update == 0) {
+					connected = connected && send_rows();
+				}
+			}
+		}
+	}
+	return connected && !ecosystem.halo_lost && send_rows();
+}
+
+/**
+ * @brief Corre la simulación repartida en params.processes procesos.
+ *
+ * La cuadrícula se divide en franjas de filas de tiles (split_stripes), una por proceso hijo. Las
+ * franjas vecinas se conectan con un socket Unix y se pasan sus filas de borde en cada fase (ver
+ * Halo_Links); cada una además tiene un socket con este proceso, que suma los registros de todas
+ * y escribe la serie de tiempo. Este proceso nunca arma la cuadrícula: las filas de cada franja se
+ * reciben en tramos de rows_chunk_bytes y van directo al Frame_Renderer, en orden. La salida es la
+ * misma que con un solo proceso.
+ * @param params Parámetros de la corrida, ya validados.
+ * @return Código de salida del programa.
+ */
+inline int run_distributed(const Parameters& params) {
+#ifndef _WIN32
+	const int count = params.processes;
+	Series_Recorder series;  // Antes de fork: si no se puede escribir, no se lanza ninguna franja.
+	if (!params.series.empty() && !series.open(params.series, params.compress_series != 0)) {
+		return 1;
+	}
+	const vector<Stripe> stripes = split_stripes(params.rows, params.tile_size, count);
+	vector<int> coordinator_ends(count), stripe_ends(count), up(count, -1), down(count, -1);
+	for (int k = 0; k < count; ++k) {
+		int pair[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+			perror("socketpair");
+			return 1;
+		}
+		coordinator_ends[k] = pair[0];
+		stripe_ends[k] = pair[1];
+		if (k > 0) {
+			if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+				perror("socketpair");
+				return 1;
+			}
+			down[k - 1] = pair[0];
+			up[k] = pair[1];
+		}
+	}
+
+	fflush(stdout);
+	vector<pid_t> children;
+	for (int k = 0; k < count; ++k) {
+		const pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pid == 0) {
+			for (int other = 0; other < count; ++other) {
+				close(coordinator_ends[other]);
+				if (other != k) {
+					close(stripe_ends[other]);
+					if (up[other] >= 0) close(up[other]);
+					if (down[other] >= 0) close(down[other]);
+				}
+			}
+			Halo_Links links = { stripes[k], params.tile_size, up[k], down[k] };
+			Ecosystem ecosystem(params, stripes[k]);
+			ecosystem.halo = &links;
+			bool connected = true;
+			with_rules(params.species, [&](const auto& rules) {
+				connected = simulate_stripe(ecosystem, rules, stripe_ends[k]);
+			});
+			if (params.load_report != 0) {
+				ostringstream report;
+				report << "stripe " << k << " (rows " << stripes[k].first_row << "-" << stripes[k].last_row - 1 << ")" << endl;
+				ecosystem.scheduler.report(report);
+				cerr << report.str() << flush;
+			}
+			_exit(connected ? 0 : 1);
+		}
+		children.push_back(pid);
+	}
+	for (int k = 0; k < count; ++k) {
+		close(stripe_ends[k]);
+		if (up[k] >= 0) close(up[k]);
+		if (down[k] >= 0) close(down[k]);
+	}
+
+	const size_t stride = size_t(params.cols) + 2;  // Las franjas mandan sus filas con las columnas de pared.
+	const size_t chunk_rows = max<size_t>(1, rows_chunk_bytes / (stride * sizeof(Cell)));
+	vector<Cell> chunk;
+	Frame_Renderer renderer(params.rows, params.cols, params.display);
+	bool connected = true;
+	const auto receive_records = [&] {
+		Tick_Record total = {};
+		for (int k = 0; k < count && connected; ++k) {
+			Tick_Record part;
+			connected = receive_all(coordinator_ends[k], &part, sizeof(part));
+			merge_record(total, part);
+		}
+		if (series.is_open() && connected) {
+			series.push(total);
+		}
+		return total;
+	};
+	// Las filas se leen del socket aunque el cuadro se salte, para no desfasar el flujo de cada franja.
+	const auto receive_frame = [&](const Tick_Record& record, const bool& last) {
+		const bool drawing = renderer.begin_frame(record, last);
+		for (int k = 0; k < count && connected; ++k) {
+			const int first_row = stripes[k].first_row;
+			const int owned = stripes[k].owned_rows();
+			for (int row = 0; row < owned && connected; row += int(chunk_rows)) {
+				const int taken = min(owned - row, int(chunk_rows));
+				chunk.resize(size_t(taken) * stride);
+				connected = receive_all(coordinator_ends[k], chunk.data(), chunk.size() * sizeof(Cell));
+				for (int r = 0; r < taken && connected && drawing; ++r) {
+					renderer.add_row(first_row + row + r, chunk.data() + size_t(r) * stride + 1);
+				}
+			}
+		}
+		if (drawing && connected) {
+			renderer.end_frame();
+		}
+	};
+
+	Tick_Record record = receive_records();
+	for (int tick = 0; tick < params.ticks && connected; ++tick) {
+		record = receive_records();
+		if (tick % params.tick_update == 0 && connected) {
+			receive_frame(record, false);
+		}
+	}
+	if (connected) {
+		receive_frame(record, true);
+	}
+	renderer.close();
+	const bool written = series.close();
+
+	for (int k = 0; k < count; ++k) {
+		close(coordinator_ends[k]);
+	}
+	bool succeeded = connected;
+	for (const pid_t& pid : children) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+		succeeded &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	if (!succeeded) {
+		cerr << "A stripe process failed" << endl;
+		return 1;
+	}
+	return written ? 0 : 1;
+#else
+	(void)params;
+	cerr << "processes > 1 needs fork and Unix sockets; run with a single process" << endl;
+	return 1;
+#endif
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+/**
+ * @file Ensemble.hpp
+ * @brief Muchas corridas pequeñas e independientes a la vez (barridos de parámetros y semillas), con un resumen por corrida.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include "Parameters.hpp"
+#include "Simulation.hpp"
+
+using namespace std;
+
+/**
+ * @struct Run_Summary
+ * @brief Resultado de una corrida del ensamble.
+ */
+struct Run_Summary {
+	int line;                       /**< Línea del archivo del ensamble (desde 1). */
+	Parameters params;              /**< Parámetros de la corrida. */
+	array<int64_t, 4> population;   /**< Células de cada especie al final. */
+	array<int, 4> extinction;       /**< Primer tick en que la especie llegó a 0 células, o -1 si nunca. */
+	double period;                  /**< Período de oscilación de los herbívoros en ticks, o 0 si no oscilan. */
+	double seconds;                 /**< Duración de la corrida. */
+};
+
+/**
+ * @brief Lee las corridas de un ensamble: una línea por configuración, con pares "nombre=valor" separados por espacios.
+ *
+ * Cada línea parte de los parámetros base; '#' inicia un comentario y las líneas vacías se ignoran.
+ * Cada configuración se repite base.runs veces con semillas consecutivas desde la suya.
+ * @param base Parámetros base (de la línea de comandos).
+ * @param runs Corridas leídas; cada una con threads = 1.
+ * @param lines Línea del archivo de cada corrida.
+ * @return false si el archivo no se puede abrir o alguna línea es inválida.
+ */
+inline bool load_ensemble(const Parameters& base, vector<Parameters>& runs, vector<int>& lines) {
+	ifstream file(base.ensemble);
+	if (!file) {
+		cerr << "Cannot open ensemble file: " << base.ensemble << endl;
+		return false;
+	}
+	bool ok = true;
+	string line;
+	for (int number = 1; getline(file, line); ++number) {
+		line = line.substr(0, line.find('#'));
+		istringstream tokens(line);
+		Parameters params = base;
+		params.threads = 1;
+		bool empty = true;
+		for (string token; tokens >> token; empty = false) {
+			const size_t equals = token.find('=');
+			if (equals == string::npos || !set_parameter(params, token.substr(0, equals), token.substr(equals + 1))) {
+				cerr << base.ensemble << ":" << number << ": invalid setting " << token << endl;
+				ok = false;
+			}
+		}
+		if (empty) {
+			continue;
+		}
+		for (int copy = 0; copy < base.runs; ++copy) {
+			runs.push_back(params);
+			runs.back().seed = params.seed + uint64_t(copy);
+			lines.push_back(number);
+		}
+	}
+	if (ok && runs.empty()) {
+		cerr << base.ensemble << ": no runs" << endl;
+		ok = false;
+	}
+	return ok;
+}
+
+/**
+ * @brief Estima el período de oscilación de una población por autocorrelación.
+ *
+ * Se descarta la primera mitad de la serie (el transitorio desde la distribución inicial) y se busca,
+ * después del primer cruce por cero de la autocorrelación, el primer máximo local mayor que 0.2.
+ * @param series Población en cada tick.
+ * @return Período en ticks, o 0 si la serie no oscila.
+ */
+inline double oscillation_period(const vector<int64_t>& series) {
+	const size_t begin = series.size() / 2;
+	const size_t n = series.size() - begin;
+	if (n < 8) {
+		return 0.0;
+	}
+	double mean = 0.0;
+	for (size_t t = begin; t < series.size(); ++t) {
+		mean += double(series[t]) / n;
+	}
+	vector<double> centered(n);
+	double variance = 0.0;
+	for (size_t t = 0; t < n; ++t) {
+		centered[t] = double(series[begin + t]) - mean;
+		variance += centered[t] * centered[t];
+	}
+	if (variance == 0.0) {
+		return 0.0;
+	}
+	const auto correlation = [&](const size_t& lag) {
+		double sum = 0.0;
+		for (size_t t = 0; t + lag < n; ++t) {
+			sum += centered[t] * centered[t + lag];
+		}
+		return sum / variance;
+	};
+	bool crossed = false;
+	double previous = 1.0;
+	double current = correlation(1);
+	for (size_t lag = 1; lag + 1 < n / 2; ++lag) {
+		const double following = correlation(lag + 1);
+		crossed = crossed || current < 0.0;
+		if (crossed && current > 0.2 && current >= previous && current >= following) {
+			return double(lag);
+		}
+		previous = current;
+		current = following;
+	}
+	return 0.0;
+}
+
+/**
+ * @brief Simula una corrida del ensamble de principio a fin, con un solo hilo.
+ *
+ * Abre su propia región paralela de un hilo, así que advance() funciona igual dentro del omp parallel
+ * for del ensamble y la corrida da el mismo resultado que sola con cualquier número de hilos.
+ * @param params Parámetros de la corrida.
+ * @param summary Resumen a llenar (salvo line).
+ */
+inline void run_member(const Parameters& params, Run_Summary& summary) {
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	summary.params = params;
+	summary.extinction.fill(-1);
+	vector<int64_t> herbivores;
+	herbivores.reserve(size_t(params.ticks) + 1);
+	const auto observe = [&](const Tick_Record& record) {
+		herbivores.push_back(record.population[int(Species::Herbivore)]);
+		for (int s = int(Species::Plant); s < 4; ++s) {
+			if (record.population[s] == 0 && summary.extinction[s] < 0) {
+				summary.extinction[s] = record.tick;
+			}
+		}
+		summary.population = record.population;
+	};
+	with_layout(params.layout, [&](auto layout) {
+		Basic_Ecosystem<typename decltype(layout)::type> ecosystem(params);
+		with_rules(params.species, [&](const auto& rules) {
+			initialize_grid(ecosystem, rules);
+			observe(ecosystem.stats.latest());
+			#pragma omp parallel num_threads(1)
+			{
+				ecosystem.planes.build(ecosystem.grid);
+				for (int tick = 0; tick < params.ticks; ++tick) {
+					advance(ecosystem, tick, rules);
+					observe(ecosystem.stats.latest());
+				}
+			}
+		});
+	});
+	summary.period = oscillation_period(herbivores);
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	summary.seconds = elapsed.count();
+}
+
+/**
+ * @brief Corre todas las corridas repartidas entre params.threads hilos, una corrida por hilo a la vez.
+ * @param runs Corridas del ensamble.
+ * @param lines Línea del archivo de cada corrida.
+ * @param threads Hilos del ensamble.
+ * @param seconds Duración total.
+ * @return Un resumen por corrida, en el orden de runs.
+ */
+inline vector<Run_Summary> run_ensemble(const vector<Parameters>& runs, const vector<int>& lines, const int& threads, double& seconds) {
+	vector<Run_Summary> summaries(runs.size());
+	const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+	for (int r = 0; r < int(runs.size()); ++r) {
+		run_member(runs[r], summaries[r]);
+		summaries[r].line = lines[r];
+	}
+	const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	seconds = elapsed.count();
+	return summaries;
+}
+
+/**
+ * @brief Cadena JSON con comillas: escapa las comillas, las barras invertidas y los caracteres de control.
+ * @param text Texto a escribir (una ruta, por ejemplo).
+ * @return El texto entre comillas, listo para el JSON.
+ */
+inline string json_string(const string& text) {
+	static const char hex[] = "0123456789abcdef";
+	string quoted = "\"";
+	for (const char& c : text) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+			quoted += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			quoted += "\\u00";
+			quoted += hex[c >> 4];
+			quoted += hex[c & 15];
+		}
+		else {
+			quoted += c;
+		}
+	}
+	return quoted + '"';
+}
+
+/**
+ * @brief Escribe una fila por corrida en JSON o CSV.
+ * @param out Flujo de salida.
+ * @param params Parámetros base del ensamble.
+ * @param summaries Resúmenes de las corridas.
+ * @param seconds Duración total del ensamble.
+ */
+inline void write_ensemble(ostream& out, const Parameters& params, const vector<Run_Summary>& summaries, const double& seconds) {
+	const auto extinction = [](const Run_Summary& summary, const Species& species) { return summary.extinction[int(species)]; };
+	if (params.format == Report_Format::Csv) {
+		out << "run,line,seed,ticks,plant_spawn_rate,herbivore_spawn_rate,carnivore_spawn_rate,plants,herbivores,carnivores,"
+			<< "plant_extinction_tick,herbivore_extinction_tick,carnivore_extinction_tick,herbivore_period,seconds" << endl;
+		for (size_t r = 0; r < summaries.size(); ++r) {
+			const Run_Summary& summary = summaries[r];
+			const Species_Parameters& species = summary.params.species;
+			out << r << "," << summary.line << "," << summary.params.seed << "," << summary.params.ticks << ","
+				<< species.plant_spawn_rate << "," << species.herbivore_spawn_rate << "," << species.carnivore_spawn_rate << ","
+				<< summary.population[int(Species::Plant)] << "," << summary.population[int(Species::Herbivore)] << "," << summary.population[int(Species::Carnivore)] << ","
+				<< extinction(summary, Species::Plant) << "," << extinction(summary, Species::Herbivore) << "," << extinction(summary, Species::Carnivore) << ","
+				<< summary.period << "," << summary.seconds << endl;
+		}
+		return;
+	}
+	out << "{" << endl;
+	out << "  \"ensemble\": " << json_string(params.ensemble) << "," << endl;
+	out << "  \"threads\": " << params.threads << "," << endl;
+	out << "  \"seconds\": " << seconds << "," << endl;
+	out << "  \"runs_per_second\": " << (seconds > 0.0 ? summaries.size() / seconds : 0.0) << "," << endl;
+	out << "  \"runs\": [" << endl;
+	for (size_t r = 0; r < summaries.size(); ++r) {
+		const Run_Summary& summary = summaries[r];
+		const Species_Parameters& species = summary.params.species;
+		out << "    { \"run\": " << r << ", \"line\": " << summary.line << ", \"seed\": " << summary.params.seed << ", \"ticks\": " << summary.params.ticks
+			<< ", \"plant_spawn_rate\": " << species.plant_spawn_rate << ", \"herbivore_spawn_rate\": " << species.herbivore_spawn_rate
+			<< ", \"carnivore_spawn_rate\": " << species.carnivore_spawn_rate
+			<< ", \"plants\": " << summary.population[int(Species::Plant)] << ", \"herbivores\": " << summary.population[int(Species::Herbivore)]
+			<< ", \"carnivores\": " << summary.population[int(Species::Carnivore)]
+			<< ", \"plant_extinction_tick\": " << extinction(summary, Species::Plant) << ", \"herbivore_extinction_tick\": " << extinction(summary, Species::Herbivore)
+			<< ", \"carnivore_extinction_tick\": " << extinction(summary, Species::Carnivore)
+			<< ", \"herbivore_period\": " << summary.period << ", \"seconds\": " << summary.seconds << " }" << (r + 1 < summaries.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+/**
+ * @brief Lee, valida y corre el ensamble de params.ensemble, y escribe los resúmenes en la salida estándar.
+ * @param params Parámetros base, ya validados.
+ * @return Código de salida del programa.
+ */
+inline int simulate_ensemble(const Parameters& params) {
+	vector<Parameters> runs;
+	vector<int> lines;
+	if (!load_ensemble(params, runs, lines)) {
+		return 1;
+	}
+	for (size_t r = 0; r < runs.size(); ++r) {
+		if (!validate_parameters(runs[r])) {
+			cerr << params.ensemble << ":" << lines[r] << ": invalid run" << endl;
+			return 1;
+		}
+	}
+	double seconds = 0.0;
+	const vector<Run_Summary> summaries = run_ensemble(runs, lines, params.threads, seconds);
+	write_ensemble(cout, params, summaries, seconds);
+	return 0;
+}
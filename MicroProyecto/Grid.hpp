@@ -0,0 +1,408 @@
+#pragma once
+
+/**
+ * @file Grid.hpp
+ * @brief Motor de cuadrícula plano con doble búfer de células empaquetadas.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Species.hpp"
+#include "Storage.hpp"
+
+using namespace std;
+
+/**
+ * @struct Cell
+ * @brief Célula empaquetada en 32 bits: especie (2), edad (8), hambre (6) y energía (16).
+ *
+ * Las plantas no guardan su edad sino el tick en que la tienen en 0, módulo 256 (ver plant_age()): así
+ * envejecen sin que nadie las escriba. Como mueren antes de los 255 ticks, el módulo no se confunde.
+ *
+ * Los contadores saturan en sus límites en lugar de desbordarse. Una energía o un hambre que en
+ * la versión con int quedaban negativos ahora quedan en 0, y las reglas los tratan igual (<= 0).
+ */
+struct Cell {
+	static constexpr int max_age = 0xFF;       /**< Edad máxima representable. */
+	static constexpr int max_hunger = 0x3F;    /**< Hambre máxima representable. */
+	static constexpr int max_energy = 0xFFFF;  /**< Energía máxima representable. */
+
+	uint32_t bits;  /**< Campos empaquetados. */
+
+	/**
+	 * @brief Constructor para inicializar una célula con una especie, sin edad, hambre ni energía.
+	 * @param species Especie a la que pertenece la célula.
+	 */
+	Cell(const Species& species = Species::Empty): bits(uint32_t(species)) {}
+
+	/** @return Especie en la célula. */
+	Species species() const { return Species(bits & 0x3u); }
+	/** @return Edad de la célula. */
+	int age() const { return int((bits >> 2) & 0xFFu); }
+	/** @return Edad de una planta al procesar el tick now. */
+	int plant_age(const int& now) const { return int((uint32_t(now) - (bits >> 2)) & 0xFFu); }
+	/** @return Nivel de hambre de la célula. */
+	int hunger() const { return int((bits >> 10) & 0x3Fu); }
+	/** @return Energía de la célula. */
+	int energy() const { return int(bits >> 16); }
+
+	/** @brief Cambia la edad, saturando en [0, max_age]. */
+	void set_age(const int& value) { bits = (bits & ~(0xFFu << 2)) | (uint32_t(clamp(value, 0, max_age)) << 2); }
+	/** @brief Marca una planta con el tick en que su edad es 0. */
+	void set_birth(const int& tick) { bits = (bits & ~(0xFFu << 2)) | ((uint32_t(tick) & 0xFFu) << 2); }
+	/** @brief Cambia el hambre, saturando en [0, max_hunger]. */
+	void set_hunger(const int& value) { bits = (bits & ~(0x3Fu << 10)) | (uint32_t(clamp(value, 0, max_hunger)) << 10); }
+	/** @brief Cambia la energía, saturando en [0, max_energy]. */
+	void set_energy(const int& value) { bits = (bits & 0xFFFFu) | (uint32_t(clamp(value, 0, max_energy)) << 16); }
+
+	/** @brief Suma un tick a la edad. */
+	void grow_older() { set_age(age() + 1); }
+	/** @brief Suma (o resta) energía. */
+	void add_energy(const int& delta) { set_energy(energy() + delta); }
+	/** @brief Suma (o resta) hambre. */
+	void add_hunger(const int& delta) { set_hunger(hunger() + delta); }
+
+	bool operator==(const Cell& other) const { return bits == other.bits; }
+
+	/**
+	 * @brief Célula de relleno alrededor de la cuadrícula (pared).
+	 *
+	 * Su especie no es vacía ni planta y los planos de bits nunca la marcan, así que ningún animal se
+	 * mueve a ella ni nace en ella: las reglas la tratan como una posición fuera de la cuadrícula.
+	 */
+	static Cell wall() {
+		Cell cell;
+		cell.bits = ~0u;
+		return cell;
+	}
+};
+static_assert(sizeof(Cell) == 4, "Cell debe ocupar 4 bytes");
+
+/** Un búfer completo de la cuadrícula: una asignación contigua de células empaquetadas. */
+using Grid_Buffer = Paged_Array<Cell>;
+
+/**
+ * @struct Row_Major_Layout
+ * @brief Orden de las células en memoria fila por fila, con una célula de relleno a cada lado.
+ */
+struct Row_Major_Layout {
+	int stride;  /**< Células por fila en memoria: cols más una de relleno a cada lado. */
+
+	/**
+	 * @param rows Número de filas.
+	 * @param cols Número de columnas.
+	 */
+	Row_Major_Layout(const int& rows, const int& cols): stride(cols + 2), total(size_t(rows + 2) * (cols + 2)) {}
+
+	/** @return Células de un búfer, relleno incluido. */
+	size_t cells() const { return total; }
+	/** @return Índice de (x, y), de -1 a rows y de -1 a cols. */
+	size_t index(const int& x, const int& y) const { return size_t(x + 1) * stride + (y + 1); }
+	/** @return Células contiguas en memoria desde la columna y hacia la derecha. */
+	int run(const int&) const { return INT_MAX; }
+	/** @return Filas y columnas de relleno antes de la fila y la columna 0. */
+	int padding() const { return 1; }
+	/** @return Filas en memoria, relleno incluido. */
+	int padded_rows() const { return int(total / stride); }
+	/** @return Columnas en memoria, relleno incluido. */
+	int padded_cols() const { return stride; }
+	/** @return Filas que comparten páginas y conviene que toque primero el mismo hilo. */
+	int band() const { return 1; }
+
+private:
+	size_t total;  /**< Células de un búfer. */
+};
+
+/**
+ * @brief Intercala los bits de dos coordenadas (código de Morton, orden Z).
+ * @param x Coordenada que ocupa los bits impares.
+ * @param y Coordenada que ocupa los bits pares.
+ */
+inline uint64_t morton_code(const uint32_t& x, const uint32_t& y) {
+	const auto spread = [](uint64_t v) {
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	};
+	return (spread(x) << 1) | spread(y);
+}
+
+/**
+ * @struct Morton_Layout
+ * @brief Orden de las células en bloques de Side x Side contiguos, con los bloques en orden Z.
+ *
+ * Dentro de un bloque las células van fila por fila; los bloques se guardan según el código de Morton
+ * de su posición, así que los bloques vecinos (también en vertical) suelen quedar cerca en memoria. El
+ * relleno es un anillo de bloques completo: la célula (0, 0) empieza un bloque, y los tiles de
+ * Tile_Phases con tile_size múltiplo de Side coinciden con bloques.
+ * @tparam Side Lado de los bloques (potencia de 2).
+ */
+template<int Side = 16>
+struct Morton_Layout {
+	static_assert(Side > 0 && (Side & (Side - 1)) == 0, "Side debe ser potencia de 2");
+
+	/**
+	 * @brief Ordena los bloques por su código de Morton.
+	 * @param rows Número de filas.
+	 * @param cols Número de columnas.
+	 */
+	Morton_Layout(const int& rows, const int& cols): block_rows((rows + Side) / Side + 1), block_cols((cols + Side) / Side + 1), base(size_t(block_rows) * block_cols) {
+		vector<pair<uint64_t, int>> order;
+		for (int bx = 0; bx < block_rows; ++bx) {
+			for (int by = 0; by < block_cols; ++by) {
+				order.push_back({ morton_code(uint32_t(bx), uint32_t(by)), bx * block_cols + by });
+			}
+		}
+		sort(order.begin(), order.end());
+		for (size_t slot = 0; slot < order.size(); ++slot) {
+			base[order[slot].second] = slot * Side * Side;
+		}
+	}
+
+	/** @return Células de un búfer, relleno incluido. */
+	size_t cells() const { return base.size() * Side * Side; }
+	/** @return Índice de (x, y), de -1 a rows y de -1 a cols. */
+	size_t index(const int& x, const int& y) const {
+		const unsigned px = unsigned(x + Side);
+		const unsigned py = unsigned(y + Side);
+		return base[size_t(px / Side) * block_cols + py / Side] + size_t(px % Side) * Side + py % Side;
+	}
+	/** @return Células contiguas en memoria desde la columna y hacia la derecha (hasta el final del bloque). */
+	int run(const int& y) const { return Side - int(unsigned(y + Side) % Side); }
+	/** @return Filas y columnas de relleno antes de la fila y la columna 0 (un bloque). */
+	int padding() const { return Side; }
+	/** @return Filas en memoria, relleno incluido. */
+	int padded_rows() const { return block_rows * Side; }
+	/** @return Columnas en memoria, relleno incluido. */
+	int padded_cols() const { return block_cols * Side; }
+	/** @return Filas que comparten páginas y conviene que toque primero el mismo hilo (una fila de bloques). */
+	int band() const { return Side; }
+
+private:
+	int block_rows;        /**< Bloques por columna, relleno incluido. */
+	int block_cols;        /**< Bloques por fila, relleno incluido. */
+	vector<size_t> base;   /**< Primera célula de cada bloque, por posición del bloque. */
+};
+
+/**
+ * @struct Basic_Grid
+ * @brief Cuadrícula con dos búferes (actual y siguiente) que se intercambian por índice en cada tick.
+ *
+ * Las reglas leen de current() y escriben en next(). Al inicio de cada tick next() se sincroniza
+ * con current() fila por fila (en paralelo), y al final swap() intercambia los papeles sin copiar.
+ *
+ * Cada búfer tiene un anillo de células de relleno (Cell::wall()) alrededor de la cuadrícula: las
+ * posiciones (-1, y), (rows, y), (x, -1) y (x, cols) existen en memoria, así que los 8 vecinos de
+ * cualquier célula se calculan sin comprobar límites.
+ *
+ * Los búferes se reservan sin llenar y se escriben una sola vez, los dos a la vez, con un omp for
+ * estático sobre tramos de layout.band() filas: en una máquina NUMA cada hilo toca primero las filas
+ * que el reparto inicial de Tile_Scheduler (tramos contiguos de filas de tiles) o el omp for estático
+ * de Schedule::Rows le dan después, y con params.storage cada página del archivo se escribe una vez.
+ * @tparam Layout Orden de las células en memoria (Row_Major_Layout o Morton_Layout).
+ */
+template<typename Layout>
+struct Basic_Grid {
+	int rows;        /**< Número de filas. */
+	int cols;        /**< Número de columnas. */
+	int row_offset;  /**< Fila de la cuadrícula completa que corresponde a la fila 0 (distinta de 0 en una franja de otro proceso). */
+	Layout layout;   /**< Orden de las células en memoria. */
+
+	/**
+	 * @brief Construye una cuadrícula vacía.
+	 * @param rows Número de filas.
+	 * @param cols Número de columnas.
+	 * @param row_offset Fila de la cuadrícula completa que corresponde a la fila 0.
+	 * @param storage Directorio de los archivos mapeados de los búferes; vacío = en el heap (ver Paged_Array).
+	 * @param threads Hilos que tocan primero las páginas (ver la descripción de la estructura).
+	 */
+	Basic_Grid(const int& rows, const int& cols, const int& row_offset = 0, const string& storage = "", const int& threads = 1):
+		rows(rows), cols(cols), row_offset(row_offset), layout(rows, cols), front(0)
+	{
+		for (Grid_Buffer& buffer : buffers) {
+			buffer.allocate(layout.cells(), storage);
+		}
+		const int pad = layout.padding();
+		const int bands = (layout.padded_rows() + layout.band() - 1) / layout.band();
+		#pragma omp parallel for schedule(static) num_threads(threads)
+		for (int band = 0; band < bands; ++band) {
+			const int x0 = band * layout.band() - pad;
+			const int x1 = min(x0 + layout.band(), layout.padded_rows() - pad);
+			for (int x = x0; x < x1; ++x) {
+				const bool inside = x >= 0 && x < rows;
+				for_each_run(x, -pad, layout.padded_cols() - pad, [&](const size_t& n, const int& y, const int& count) {
+					// Tramo [y, y + count) partido en pared, vacío (las columnas de la cuadrícula) y pared.
+					const int empty0 = inside ? clamp(-y, 0, count) : count;
+					const int empty1 = inside ? clamp(cols - y, empty0, count) : count;
+					for (Grid_Buffer& buffer : buffers) {
+						Cell* const first = buffer.begin() + n;
+						fill(first, first + empty0, Cell::wall());
+						fill(first + empty0, first + empty1, Cell(Species::Empty));
+						fill(first + empty1, first + count, Cell::wall());
+					}
+				});
+			}
+		}
+	}
+
+	/**
+	 * @brief Construye una cuadrícula sobre dos búferes ya llenos, relleno incluido (p. ej. proyectados de un punto de control).
+	 * @param rows Número de filas.
+	 * @param cols Número de columnas.
+	 * @param current Búfer actual, con layout.cells() células.
+	 * @param next Búfer siguiente, con el mismo contenido.
+	 */
+	Basic_Grid(const int& rows, const int& cols, Grid_Buffer&& current, Grid_Buffer&& next):
+		rows(rows), cols(cols), row_offset(0), layout(rows, cols), buffers{ move(current), move(next) }, front(0) {}
+
+	/** @return Índice lineal de la posición (x, y), de -1 a rows y de -1 a cols (relleno incluido). */
+	size_t index(const int& x, const int& y) const { return layout.index(x, y); }
+	/** @return Índice de (x, y) en la cuadrícula completa: identifica la célula en los sorteos. */
+	uint64_t cell_id(const int& x, const int& y) const { return uint64_t(x + row_offset) * cols + y; }
+
+	/**
+	 * @brief Recorre un tramo de una fila en trozos contiguos en memoria.
+	 * @param x Fila del tramo.
+	 * @param y0 Primera columna.
+	 * @param y1 Columna siguiente a la última.
+	 * @param function Recibe el índice del primer elemento, su columna y el número de células del trozo.
+	 */
+	template<typename Function>
+	void for_each_run(const int& x, const int& y0, const int& y1, Function&& function) const {
+		for (int y = y0; y < y1;) {
+			const int count = min(y1 - y, layout.run(y));
+			function(index(x, y), y, count);
+			y += count;
+		}
+	}
+
+	/** @return Búfer con el estado del tick actual. */
+	Grid_Buffer& current() { return buffers[front]; }
+	/** @return Búfer con el estado del tick actual. */
+	const Grid_Buffer& current() const { return buffers[front]; }
+	/** @return Búfer donde se escribe el siguiente tick. */
+	Grid_Buffer& next() { return buffers[1 - front]; }
+
+	/**
+	 * @brief Copia una fila del búfer actual al siguiente antes de aplicar las reglas.
+	 * @param x Fila a sincronizar.
+	 */
+	void sync_row(const int& x) {
+		sync_span(x, 0, cols);
+	}
+
+	/**
+	 * @brief Copia un tramo de una fila del búfer actual al siguiente.
+	 * @param x Fila del tramo.
+	 * @param y0 Primera columna.
+	 * @param y1 Columna siguiente a la última.
+	 */
+	void sync_span(const int& x, const int& y0, const int& y1) {
+		for_each_run(x, y0, y1, [this](const size_t& n, const int&, const int& count) {
+			copy(current().begin() + n, current().begin() + n + count, next().begin() + n);
+		});
+	}
+
+	/**
+	 * @brief Pide al disco las filas [x0, x1) de los dos búferes, relleno incluido, si viven en archivos mapeados.
+	 * @param x0 Primera fila (desde -1).
+	 * @param x1 Fila siguiente a la última (hasta rows + 1).
+	 */
+	void prefetch_rows(const int& x0, const int& x1) const {
+		if (!buffers[0].is_mapped()) {
+			return;
+		}
+		for (int x = max(x0, -1); x < min(x1, rows + 1); ++x) {
+			for_each_run(x, -1, cols + 1, [this](const size_t& n, const int&, const int& count) {
+				buffers[0].prefetch(n, count);
+				buffers[1].prefetch(n, count);
+			});
+		}
+	}
+
+	/** @brief Intercambia los búferes: el siguiente pasa a ser el actual. */
+	void swap() { front = 1 - front; }
+
+	/**
+	 * @brief Intercambia los búferes y entrega el que deja de ser actual, sin copiarlo.
+	 *
+	 * El búfer con el estado anterior queda en spare y el contenido de spare pasa a ser el siguiente:
+	 * antes de aplicar las reglas hay que sincronizarlo entero (ver Active_Tiles::forget_idle).
+	 * @param spare Búfer de layout.cells() células con el relleno de Cell::wall().
+	 */
+	void swap(Grid_Buffer& spare) {
+		front = 1 - front;
+		std::swap(buffers[1 - front], spare);
+	}
+
+private:
+	Grid_Buffer buffers[2];  /**< Los dos búferes de la cuadrícula. */
+	int front;               /**< Índice del búfer actual. */
+};
+
+/**
+ * @struct Grid_View
+ * @brief Los búferes de una Basic_Grid vistos desde un tick posterior: con un número impar de ticks de distancia, actual y siguiente cambian de papel.
+ *
+ * Ofrece a las reglas y a los planos de bits lo mismo que la cuadrícula, así que varios ticks pueden
+ * avanzar a la vez sobre los mismos dos búferes, cada uno en filas distintas (ver advance_block).
+ * @tparam Layout Orden de las células en memoria.
+ */
+template<typename Layout>
+struct Grid_View {
+	int rows;                        /**< Número de filas. */
+	int cols;                        /**< Número de columnas. */
+	const Basic_Grid<Layout>& grid;  /**< Cuadrícula vista. */
+
+	/**
+	 * @param grid Cuadrícula vista.
+	 * @param ahead Ticks entre el actual de la cuadrícula y el de la vista.
+	 */
+	Grid_View(Basic_Grid<Layout>& grid, const int& ahead): rows(grid.rows), cols(grid.cols), grid(grid),
+		buffers{ ahead % 2 == 0 ? &grid.current() : &grid.next(), ahead % 2 == 0 ? &grid.next() : &grid.current() } {}
+
+	/** @return Índice lineal de la posición (x, y) (ver Basic_Grid::index). */
+	size_t index(const int& x, const int& y) const { return grid.index(x, y); }
+	/** @return Índice de (x, y) en la cuadrícula completa (ver Basic_Grid::cell_id). */
+	uint64_t cell_id(const int& x, const int& y) const { return grid.cell_id(x, y); }
+
+	/** @brief Recorre un tramo de una fila en trozos contiguos en memoria (ver Basic_Grid::for_each_run). */
+	template<typename Function>
+	void for_each_run(const int& x, const int& y0, const int& y1, Function&& function) const {
+		grid.for_each_run(x, y0, y1, function);
+	}
+
+	/** @return Búfer con el estado del tick de la vista. */
+	Grid_Buffer& current() { return *buffers[0]; }
+	/** @return Búfer con el estado del tick de la vista. */
+	const Grid_Buffer& current() const { return *buffers[0]; }
+	/** @return Búfer donde se escribe el tick siguiente al de la vista. */
+	Grid_Buffer& next() { return *buffers[1]; }
+
+	/**
+	 * @brief Copia una fila del búfer actual de la vista al siguiente.
+	 * @param x Fila a sincronizar.
+	 */
+	void sync_row(const int& x) {
+		grid.for_each_run(x, 0, cols, [this](const size_t& n, const int&, const int& count) {
+			copy(current().begin() + n, current().begin() + n + count, next().begin() + n);
+		});
+	}
+
+private:
+	Grid_Buffer* buffers[2];  /**< Búfer actual y siguiente de la vista. */
+};
+
+/** Cuadrícula fila por fila: la de la simulación normal, los puntos de control y los procesos por franjas. */
+using Grid = Basic_Grid<Row_Major_Layout>;
+
+/** Cuadrícula en bloques de 16 x 16 en orden Z. */
+using Morton_Grid = Basic_Grid<Morton_Layout<16>>;
@@ -0,0 +1,190 @@
+#pragma once
+
+/**
+ * @file Halo.hpp
+ * @brief Franjas de filas repartidas entre procesos e intercambio de sus filas de borde (halo).
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "Grid.hpp"
+
+using namespace std;
+
+/**
+ * @struct Stripe
+ * @brief Filas de la cuadrícula completa que le tocan a un proceso.
+ *
+ * La franja empieza y termina en un borde de tile, así que los tiles (y sus colores) son los mismos
+ * que en un solo proceso. El proceso guarda además una fila de halo de cada franja vecina.
+ */
+struct Stripe {
+	int first_row;     /**< Primera fila propia, en la cuadrícula completa. */
+	int last_row;      /**< Fila siguiente a la última propia. */
+	bool halo_top;     /**< Hay una franja arriba (y una fila de halo suya). */
+	bool halo_bottom;  /**< Hay una franja abajo (y una fila de halo suya). */
+
+	/** @return Filas propias. */
+	int owned_rows() const { return last_row - first_row; }
+	/** @return Filas guardadas por el proceso: las propias y las de halo. */
+	int local_rows() const { return owned_rows() + halo_top + halo_bottom; }
+	/** @return Fila de la cuadrícula completa que corresponde a la fila local 0. */
+	int row_offset() const { return first_row - halo_top; }
+};
+
+/**
+ * @brief Reparte las filas de tiles de la cuadrícula entre varios procesos, lo más parejo posible.
+ * @param rows Filas de la cuadrícula.
+ * @param tile_size Lado de los tiles (mínimo 2, como en Tile_Phases).
+ * @param count Número de franjas; cada una recibe al menos una fila de tiles.
+ */
+inline vector<Stripe> split_stripes(const int& rows, const int& tile_size, const int& count) {
+	const int size = max(tile_size, 2);
+	const int tile_rows = (rows + size - 1) / size;
+	vector<Stripe> stripes;
+	for (int k = 0; k < count; ++k) {
+		const int first = tile_rows * k / count;
+		const int last = tile_rows * (k + 1) / count;
+		stripes.push_back({ min(first * size, rows), min(last * size, rows), k > 0, k < count - 1 });
+	}
+	return stripes;
+}
+
+/**
+ * @struct Transfer
+ * @brief Bytes a enviar por un socket o a recibir de él.
+ */
+struct Transfer {
+	int fd;          /**< Socket. */
+	bool sending;    /**< true para enviar, false para recibir. */
+	uint8_t* data;   /**< Bytes a enviar, o destino de los recibidos. */
+	size_t size;     /**< Bytes que faltan. */
+};
+
+/**
+ * @brief Completa varias transferencias a la vez, sin bloquearse en ninguna.
+ *
+ * Los envíos y las recepciones avanzan a medida que los sockets lo permiten, así que dos procesos que
+ * se envían filas mutuamente no se quedan esperando con los búferes del sistema llenos.
+ * @param transfers Transferencias; se consumen.
+ * @return false si un socket se cerró o falló.
+ */
+inline bool transfer_all(vector<Transfer>& transfers) {
+#ifndef _WIN32
+	vector<pollfd> polls;
+	for (;;) {
+		polls.clear();
+		for (const Transfer& transfer : transfers) {
+			if (transfer.size > 0) {
+				polls.push_back({ transfer.fd, short(transfer.sending ? POLLOUT : POLLIN), 0 });
+			}
+		}
+		if (polls.empty()) {
+			return true;
+		}
+		if (poll(polls.data(), polls.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		size_t p = 0;
+		for (Transfer& transfer : transfers) {
+			if (transfer.size == 0) {
+				continue;
+			}
+			const short events = polls[p++].revents;
+			if (events == 0) {
+				continue;
+			}
+			const ssize_t done = transfer.sending ? write(transfer.fd, transfer.data, transfer.size) : read(transfer.fd, transfer.data, transfer.size);
+			if (done < 0 && (errno == EINTR || errno == EAGAIN)) {
+				continue;
+			}
+			if (done <= 0) {
+				return false;
+			}
+			transfer.data += done;
+			transfer.size -= size_t(done);
+		}
+	}
+#else
+	return transfers.empty();
+#endif
+}
+
+/** @brief Envía bytes por un socket hasta terminar. @return false si falló. */
+inline bool send_all(const int& fd, const void* data, const size_t& size) {
+	vector<Transfer> transfers = { { fd, true, (uint8_t*)data, size } };
+	return transfer_all(transfers);
+}
+
+/** @brief Recibe exactamente size bytes de un socket. @return false si falló o se cerró antes. */
+inline bool receive_all(const int& fd, void* data, const size_t& size) {
+	vector<Transfer> transfers = { { fd, false, (uint8_t*)data, size } };
+	return transfer_all(transfers);
+}
+
+/**
+ * @struct Halo_Links
+ * @brief Sockets con las franjas vecinas y el intercambio de filas de borde durante el tick.
+ *
+ * En una fase de color solo trabajan los tiles de una paridad de fila, así que en cada borde entre dos
+ * franjas hay un solo lado activo: el que tiene su fila de tiles del borde en esa paridad. Ese lado es
+ * el único que escribe las dos filas que rodean el borde (la suya y la de halo), y al terminar la fase
+ * se las envía al otro, que las reemplaza. Así cada lado ve en next() lo mismo que vería un solo proceso
+ * al empezar cada fase, y los movimientos y nacimientos que cruzan el borde se resuelven igual.
+ */
+struct Halo_Links {
+	Stripe stripe;   /**< Filas del proceso. */
+	int tile_size;   /**< Lado de los tiles. */
+	int up;          /**< Socket con la franja de arriba, o -1. */
+	int down;        /**< Socket con la franja de abajo, o -1. */
+
+	/**
+	 * @brief Copia las filas de halo del búfer actual al siguiente, como Active_Tiles::sync hace con los tiles.
+	 *
+	 * Al terminar el tick anterior el halo de next() ya era igual a las filas del vecino, así que después
+	 * de Grid::swap el halo de current() está al día y no hace falta recibir nada.
+	 * @param grid Cuadrícula local.
+	 */
+	void begin_tick(Grid& grid) const {
+		if (stripe.halo_top) {
+			grid.sync_row(0);
+		}
+		if (stripe.halo_bottom) {
+			grid.sync_row(grid.rows - 1);
+		}
+	}
+
+	/**
+	 * @brief Envía o recibe las dos filas de cada borde después de una fase. Llamar desde un solo hilo, después de la barrera de la fase.
+	 * @param grid Cuadrícula local.
+	 * @param color Fase que terminó (ver Tile_Phases::color).
+	 * @return false si un vecino se desconectó.
+	 */
+	bool after_phase(Grid& grid, const int& color) const {
+		const int parity = color / 2;
+		const int size = max(tile_size, 2);
+		const size_t bytes = 2 * size_t(grid.layout.stride) * sizeof(Cell);
+		Grid_Buffer& next = grid.next();
+		vector<Transfer> transfers;
+		if (stripe.halo_top) {
+			const bool active = (stripe.first_row / size) % 2 == parity;
+			transfers.push_back({ up, active, (uint8_t*)(next.data() + grid.index(0, -1)), bytes });
+		}
+		if (stripe.halo_bottom) {
+			const bool active = ((stripe.last_row - 1) / size) % 2 == parity;
+			transfers.push_back({ down, active, (uint8_t*)(next.data() + grid.index(grid.rows - 2, -1)), bytes });
+		}
+		return transfer_all(transfers);
+	}
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+/**
+ * @file Neighbors.hpp
+ * @brief Vecindario de Moore en orden aleatorio, sin memoria dinámica.
+ */
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#include "Grid.hpp"
+
+using namespace std;
+
+/**
+ * @struct Offset
+ * @brief Desplazamiento de un vecino respecto a la célula.
+ */
+struct Offset {
+	int dx;  /**< Desplazamiento en filas. */
+	int dy;  /**< Desplazamiento en columnas. */
+};
+
+/** Los 8 vecinos de Moore, en orden fila por fila. */
+constexpr array<Offset, 8> moore_offsets = {{
+	{ -1, -1 }, { -1, 0 }, { -1, 1 },
+	{  0, -1 },            {  0, 1 },
+	{  1, -1 }, {  1, 0 }, {  1, 1 }
+}};
+
+/** Número de órdenes de las 7 primeras posiciones que deja Fisher-Yates después de fijar la última (7!). */
+constexpr uint32_t partial_orders = 5040;
+
+/**
+ * @brief Tabla de los órdenes de las posiciones 0 a 6: la parte de la permutación de neighbor_order() que no depende del primer dígito.
+ *
+ * La entrada k es la permutación que dejan los pasos i = 6..1 de Fisher-Yates con el sorteo k, con
+ * 4 bits por posición; la posición 7 vale 7.
+ */
+constexpr array<uint32_t, partial_orders> partial_order_table = [] {
+	array<uint32_t, partial_orders> table = {};
+	for (uint32_t k = 0; k < partial_orders; ++k) {
+		array<uint32_t, 8> order = { 0, 1, 2, 3, 4, 5, 6, 7 };
+		uint32_t shuffle = k;
+		for (uint32_t i = 6; i > 0; --i) {
+			const uint32_t j = shuffle % (i + 1);
+			shuffle /= (i + 1);
+			const uint32_t swapped = order[i];
+			order[i] = order[j];
+			order[j] = swapped;
+		}
+		for (uint32_t i = 0; i < 8; ++i) {
+			table[k] |= order[i] << (4 * i);
+		}
+	}
+	return table;
+}();
+
+/**
+ * @brief Permutación aleatoria de las 8 direcciones, con 4 bits por posición, sacada de partial_order_table.
+ *
+ * Es Fisher-Yates con los dígitos del sorteo en base factorial (8! < 2^32), de i = 7 a 1.
+ * El primer paso de Fisher-Yates cambia la posición 7 por la posición shuffle % 8, es decir, intercambia
+ * los valores 7 y shuffle % 8; los pasos siguientes solo dependen de (shuffle / 8) % 7!. Así quedan una
+ * consulta a la tabla y un intercambio de dos valores en paralelo en las 8 posiciones, sin bifurcaciones.
+ * @param shuffle Sorteo de 32 bits.
+ * @return Dirección (índice de moore_offsets) de la posición i en los bits 4i a 4i + 3.
+ */
+inline uint32_t neighbor_order(const uint32_t& shuffle) {
+	const uint32_t last = shuffle % 8;
+	const uint32_t order = partial_order_table[(shuffle / 8) % partial_orders];
+	// Un bit 3 por posición cuyo valor es 0 tras el xor, es decir, cuyo valor era last (o 7).
+	const auto zero = [](const uint32_t& nibbles) { return ~(((nibbles & 0x77777777u) + 0x77777777u) | nibbles) & 0x88888888u; };
+	const uint32_t matches = zero(order ^ (last * 0x11111111u)) | zero(order ^ 0x77777777u);
+	return order ^ ((matches >> 3) * 0xFu & ((last ^ 7u) * 0x11111111u));
+}
+
+/**
+ * @struct Moore_Neighbors
+ * @brief Los 8 vecinos de una célula en orden aleatorio, en 4 bytes en la pila (bordes cerrados).
+ *
+ * El orden sale de neighbor_order() y los índices se calculan solo para las direcciones que se usan.
+ * Los vecinos fuera de la cuadrícula caen en el relleno de Basic_Grid (Cell::wall()): ninguna consulta
+ * los elige, así que no hace falta comprobar límites y todas las células siguen la misma ruta.
+ */
+struct Moore_Neighbors {
+	int x;           /**< Fila de la célula. */
+	int y;           /**< Columna de la célula. */
+	uint32_t order;  /**< Dirección (índice de moore_offsets) de cada posición del orden, 4 bits por posición. */
+
+	/**
+	 * @brief Ordena los vecinos de (x, y) según un sorteo.
+	 * @param grid Cuadrícula de la célula.
+	 * @param x Fila de la célula.
+	 * @param y Columna de la célula.
+	 * @param shuffle Sorteo que decide el orden.
+	 */
+	template<typename Grid_Type>
+	Moore_Neighbors(const Grid_Type& grid, const int& x, const int& y, const uint32_t& shuffle): x(x), y(y), order(neighbor_order(shuffle)) {
+		(void)grid;
+	}
+
+	/** @return Dirección de la posición i del orden aleatorio. */
+	int direction(const int& i) const { return int((order >> (4 * i)) & 0xFu); }
+
+	/**
+	 * @brief Primer vecino, en el orden aleatorio, cuya dirección está en una máscara.
+	 * @param mask Un bit por dirección de moore_offsets (p. ej. de Neighborhood).
+	 * @return Dirección del vecino, o -1 si ningún vecino está en la máscara.
+	 */
+	int first(const uint8_t& mask) const {
+		uint32_t ordered = 0;
+		for (int i = 0; i < 8; ++i) {
+			ordered |= uint32_t((mask >> direction(i)) & 1u) << i;
+		}
+		return ordered ? direction(countr_zero(ordered)) : -1;
+	}
+
+	/**
+	 * @brief Índice lineal del vecino en una dirección.
+	 * @param grid Cuadrícula de la célula.
+	 * @param direction Índice de moore_offsets.
+	 */
+	template<typename Grid_Type>
+	size_t index(const Grid_Type& grid, const int& direction) const {
+		const Offset& offset = moore_offsets[direction];
+		return grid.index(x + offset.dx, y + offset.dy);
+	}
+};
+
+/**
+ * @struct Torus_Neighbors
+ * @brief Como Moore_Neighbors, pero los vecinos que salen por un borde entran por el opuesto (Border::Torus).
+ *
+ * Las células interiores usan la misma ruta sin comprobaciones; solo las del borde ajustan las coordenadas.
+ */
+struct Torus_Neighbors : Moore_Neighbors {
+	int rows;   /**< Filas de la cuadrícula. */
+	int cols;   /**< Columnas de la cuadrícula. */
+	bool edge;  /**< La célula está en el borde de la cuadrícula. */
+
+	/** @copydoc Moore_Neighbors::Moore_Neighbors */
+	template<typename Grid_Type>
+	Torus_Neighbors(const Grid_Type& grid, const int& x, const int& y, const uint32_t& shuffle)
+		: Moore_Neighbors(grid, x, y, shuffle), rows(grid.rows), cols(grid.cols), edge(!(x > 0 && x < grid.rows - 1 && y > 0 && y < grid.cols - 1)) {}
+
+	/** @copydoc Moore_Neighbors::index */
+	template<typename Grid_Type>
+	size_t index(const Grid_Type& grid, const int& direction) const {
+		if (!edge) {
+			return Moore_Neighbors::index(grid, direction);
+		}
+		const Offset& offset = moore_offsets[direction];
+		return grid.index((x + offset.dx + rows) % rows, (y + offset.dy + cols) % cols);
+	}
+};
@@ -0,0 +1,316 @@
+#pragma once
+
+/**
+ * @file Parameters.hpp
+ * @brief Parámetros de la simulación del ecosistema, leídos de la línea de comandos o de un archivo.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+/**
+ * @enum Schedule
+ * @brief Forma de repartir las células entre los hilos en cada tick.
+ */
+enum struct Schedule {
+	Rows,  /**< omp for sobre todas las células; las escrituras a vecinos compiten entre hilos. */
+	Tiles  /**< Tiles en fases de color; determinista para cualquier número de hilos. */
+};
+
+/**
+ * @enum Border
+ * @brief Qué hay más allá del borde de la cuadrícula.
+ */
+enum struct Border {
+	Walls,  /**< Bordes cerrados: las células del borde tienen menos vecinos. */
+	Torus   /**< El borde de arriba se une con el de abajo y el izquierdo con el derecho. */
+};
+
+/**
+ * @enum Grid_Layout
+ * @brief Orden de las células de la cuadrícula en memoria.
+ */
+enum struct Grid_Layout {
+	Rows,   /**< Fila por fila (Row_Major_Layout). */
+	Morton  /**< Bloques de 16x16 en orden Morton (Morton_Layout). */
+};
+
+/**
+ * @enum Display
+ * @brief Forma de dibujar la cuadrícula en la terminal.
+ */
+enum struct Display {
+	Live,  /**< Un solo cuadro en pantalla que se actualiza con las células que cambian. */
+	Plain  /**< Cada cuadro completo, uno debajo del otro (apto para redirigir a un archivo). */
+};
+
+/**
+ * @enum Benchmark
+ * @brief Modo de medición sin imprimir la cuadrícula.
+ */
+enum struct Benchmark {
+	None,    /**< Simulación normal, con salida en la terminal. */
+	Single,  /**< Mide la configuración dada con params.threads hilos. */
+	Strong,  /**< Escalado fuerte: misma cuadrícula, de 1 hilo a max_threads. */
+	Weak     /**< Escalado débil: filas proporcionales al número de hilos. */
+};
+
+/**
+ * @enum Report_Format
+ * @brief Formato del informe de los benchmarks.
+ */
+enum struct Report_Format { Json, Csv };
+
+/**
+ * @struct Species_Parameters
+ * @brief Constantes de las especies que leen las reglas.
+ *
+ * Los valores por defecto son la configuración original. Cuando una corrida los usa sin cambios, las
+ * reglas se instancian con Static_Rules y todas estas constantes se pliegan al compilar.
+ */
+struct Species_Parameters {
+	double plant_spawn_rate = 0.5;      /**< Porcentaje de aparición inicial de plantas. */
+	double carnivore_spawn_rate = 0.1;  /**< Porcentaje de aparición inicial de carnívoros. */
+	double herbivore_spawn_rate = 0.1;  /**< Porcentaje de aparición inicial de herbívoros. */
+
+	double plant_after_spawn_rate = 0.05;       /**< Porcentaje de aparición de plantas después del inicio. */
+	double carnivore_after_spawn_rate = 0.025;  /**< Porcentaje de aparición de carnívoros después del inicio. */
+	double herbivore_after_spawn_rate = 0.025;  /**< Porcentaje de aparición de herbívoros después del inicio. */
+
+	double plant_reproduction_chance = 0.3;  /**< Probabilidad de reproducción de las plantas. */
+	int max_plant_age = 150;                 /**< Edad máxima de las plantas antes de morir. */
+
+	int carnivore_energy = 20;  /**< Energía inicial de los carnívoros. */
+	int herbivore_energy = 15;  /**< Energía inicial de los herbívoros. */
+
+	int carnivore_reproduction_energy = 35;  /**< Energía requerida para que un carnívoro se reproduzca. */
+	int herbivore_reproduction_energy = 65;  /**< Energía requerida para que un herbívoro se reproduzca. */
+
+	int carnivore_reproduction_energy_loss = 25;  /**< Pérdida de energía al reproducirse para los carnívoros. */
+	int herbivore_reproduction_energy_loss = 45;  /**< Pérdida de energía al reproducirse para los herbívoros. */
+
+	int carnivore_satiation = 40;  /**< Nivel de pancita llena inicial de los carnívoros. */
+	int herbivore_satiation = 20;  /**< Nivel de pancita llena inicial de los herbívoros. */
+
+	int carnivore_energy_gain = 20;  /**< Energía ganada por un carnívoro al comer un herbívoro, además de la energía del herbívoro. */
+	int herbivore_energy_gain = 10;  /**< Energía ganada por un herbívoro al comer una planta. */
+
+	int max_carnivore_age = 70;  /**< Edad máxima de los carnívoros antes de morir. */
+	int max_herbivore_age = 80;  /**< Edad máxima de los herbívoros antes de morir. */
+
+	bool operator==(const Species_Parameters& other) const = default;
+};
+
+/**
+ * @struct Parameters
+ * @brief Todos los parámetros de una corrida.
+ */
+struct Parameters {
+	int rows = 60;             /**< Filas de la cuadrícula. */
+	int cols = 60;             /**< Columnas de la cuadrícula. */
+	int ticks = 1500;          /**< Número de iteraciones de la simulación. */
+	int tick_update = 250;     /**< Intervalo para imprimir el estado de la cuadrícula. */
+	int threads = 12;          /**< Número de hilos a utilizar en la simulación. */
+	uint64_t seed = 2024;      /**< Semilla de todos los números aleatorios; la misma semilla reproduce la misma simulación. */
+	Schedule schedule = Schedule::Tiles;  /**< Reparto de trabajo utilizado por la simulación. */
+	int tile_size = 16;        /**< Lado de los tiles del reparto por fases de color. */
+	int temporal_block = 1;    /**< Ticks que avanza cada pasada por los tiles mientras siguen en caché (ver advance_block); 1 = uno por pasada. */
+	Border border = Border::Walls;  /**< Qué hay más allá del borde de la cuadrícula. */
+	Grid_Layout layout = Grid_Layout::Rows;  /**< Orden de las células en memoria; no cambia el resultado. */
+	string storage;            /**< Directorio de los archivos mapeados de la cuadrícula y los planos; vacío = en RAM (ver Paged_Array). */
+	int processes = 1;         /**< Procesos entre los que se reparten las filas de la cuadrícula (ver Distributed.hpp). */
+	Species_Parameters species;  /**< Constantes de las especies. */
+	Display display = Display::Live;  /**< Forma de dibujar la cuadrícula. */
+
+	string checkpoint;         /**< Archivo donde se guardan los puntos de control; vacío = no se guardan. */
+	int checkpoint_every = 0;  /**< Ticks entre puntos de control; 0 = solo al final. */
+	string restore;            /**< Punto de control del que se reanuda la corrida; vacío = cuadrícula nueva. */
+
+	string series;             /**< Archivo de la serie de tiempo por tick; vacío = no se registra. */
+	int compress_series = 0;   /**< 1 = codificar las rachas de diferencias 0 de la serie. */
+	int load_report = 0;       /**< 1 = al terminar, escribir en stderr el tiempo ocupado y ocioso de cada hilo. */
+
+	Benchmark benchmark = Benchmark::None;  /**< Modo de medición; None simula con salida normal. */
+	int repeats = 5;                        /**< Corridas por punto medido, para estimar la varianza. */
+	int max_threads = 0;                    /**< Hilos del último punto de las curvas de escalado; 0 = todos los núcleos. */
+	Report_Format format = Report_Format::Json;  /**< Formato del informe de los benchmarks y del ensamble. */
+
+	string ensemble;           /**< Archivo con las corridas de un ensamble (ver Ensemble.hpp); vacío = una sola corrida. */
+	int runs = 1;              /**< Corridas por línea del ensamble, con semillas consecutivas. */
+
+	string zones;              /**< Archivo de zonas cuyas células se cuentan en cada tick (ver Density.hpp); vacío = ninguna. */
+	string zone_report;        /**< CSV con los conteos de las zonas en cada tick. */
+	string heatmap;            /**< CSV con el mapa de densidad de cada cuadro; vacío = no se escribe. */
+	int heatmap_block = 16;    /**< Lado de los bloques del mapa de densidad. */
+};
+
+/**
+ * @brief Cambia un parámetro a partir de su nombre y su valor en texto.
+ * @param params Parámetros a modificar.
+ * @param key Nombre del parámetro, con '-' o '_' (p. ej. "max-plant-age").
+ * @param value Valor en texto.
+ * @return false si el nombre no existe o el valor no se puede leer.
+ */
+inline bool set_parameter(Parameters& params, string key, const string& value) {
+	for (char& c : key) {
+		if (c == '_') c = '-';
+	}
+	static const map<string, int Parameters::*> ints = {
+		{ "rows", &Parameters::rows }, { "cols", &Parameters::cols }, { "ticks", &Parameters::ticks },
+		{ "tick-update", &Parameters::tick_update }, { "threads", &Parameters::threads }, { "tile-size", &Parameters::tile_size },
+		{ "repeats", &Parameters::repeats }, { "max-threads", &Parameters::max_threads }, { "checkpoint-every", &Parameters::checkpoint_every },
+		{ "compress-series", &Parameters::compress_series }, { "processes", &Parameters::processes },
+		{ "load-report", &Parameters::load_report }, { "runs", &Parameters::runs }, { "heatmap-block", &Parameters::heatmap_block },
+		{ "temporal-block", &Parameters::temporal_block }
+	};
+	static const map<string, string Parameters::*> strings = {
+		{ "checkpoint", &Parameters::checkpoint }, { "restore", &Parameters::restore }, { "series", &Parameters::series },
+		{ "ensemble", &Parameters::ensemble }, { "storage", &Parameters::storage }, { "zones", &Parameters::zones },
+		{ "zone-report", &Parameters::zone_report }, { "heatmap", &Parameters::heatmap }
+	};
+	static const map<string, int Species_Parameters::*> species_ints = {
+		{ "max-plant-age", &Species_Parameters::max_plant_age },
+		{ "carnivore-energy", &Species_Parameters::carnivore_energy },
+		{ "herbivore-energy", &Species_Parameters::herbivore_energy },
+		{ "carnivore-reproduction-energy", &Species_Parameters::carnivore_reproduction_energy },
+		{ "herbivore-reproduction-energy", &Species_Parameters::herbivore_reproduction_energy },
+		{ "carnivore-reproduction-energy-loss", &Species_Parameters::carnivore_reproduction_energy_loss },
+		{ "herbivore-reproduction-energy-loss", &Species_Parameters::herbivore_reproduction_energy_loss },
+		{ "carnivore-satiation", &Species_Parameters::carnivore_satiation },
+		{ "herbivore-satiation", &Species_Parameters::herbivore_satiation },
+		{ "carnivore-energy-gain", &Species_Parameters::carnivore_energy_gain },
+		{ "herbivore-energy-gain", &Species_Parameters::herbivore_energy_gain },
+		{ "max-carnivore-age", &Species_Parameters::max_carnivore_age },
+		{ "max-herbivore-age", &Species_Parameters::max_herbivore_age }
+	};
+	static const map<string, double Species_Parameters::*> species_doubles = {
+		{ "plant-spawn-rate", &Species_Parameters::plant_spawn_rate },
+		{ "carnivore-spawn-rate", &Species_Parameters::carnivore_spawn_rate },
+		{ "herbivore-spawn-rate", &Species_Parameters::herbivore_spawn_rate },
+		{ "plant-after-spawn-rate", &Species_Parameters::plant_after_spawn_rate },
+		{ "carnivore-after-spawn-rate", &Species_Parameters::carnivore_after_spawn_rate },
+		{ "herbivore-after-spawn-rate", &Species_Parameters::herbivore_after_spawn_rate },
+		{ "plant-reproduction-chance", &Species_Parameters::plant_reproduction_chance }
+	};
+	try {
+		size_t used = 0;
+		if (key == "grid-size") {
+			params.rows = params.cols = stoi(value, &used);
+		}
+		else if (key == "seed") {
+			params.seed = stoull(value, &used);
+		}
+		else if (key == "schedule") {
+			if (value != "rows" && value != "tiles") return false;
+			params.schedule = value == "rows" ? Schedule::Rows : Schedule::Tiles;
+			used = value.size();
+		}
+		else if (key == "border") {
+			if (value != "walls" && value != "torus") return false;
+			params.border = value == "walls" ? Border::Walls : Border::Torus;
+			used = value.size();
+		}
+		else if (key == "layout") {
+			if (value != "rows" && value != "morton") return false;
+			params.layout = value == "rows" ? Grid_Layout::Rows : Grid_Layout::Morton;
+			used = value.size();
+		}
+		else if (strings.count(key)) {
+			params.*strings.at(key) = value;
+			used = value.size();
+		}
+		else if (key == "display") {
+			if (value != "live" && value != "plain") return false;
+			params.display = value == "live" ? Display::Live : Display::Plain;
+			used = value.size();
+		}
+		else if (key == "benchmark") {
+			static const map<string, Benchmark> modes = { { "none", Benchmark::None }, { "single", Benchmark::Single }, { "strong", Benchmark::Strong }, { "weak", Benchmark::Weak } };
+			if (!modes.count(value)) return false;
+			params.benchmark = modes.at(value);
+			used = value.size();
+		}
+		else if (key == "format") {
+			if (value != "json" && value != "csv") return false;
+			params.format = value == "json" ? Report_Format::Json : Report_Format::Csv;
+			used = value.size();
+		}
+		else if (ints.count(key)) {
+			params.*ints.at(key) = stoi(value, &used);
+		}
+		else if (species_ints.count(key)) {
+			params.species.*species_ints.at(key) = stoi(value, &used);
+		}
+		else if (species_doubles.count(key)) {
+			params.species.*species_doubles.at(key) = stod(value, &used);
+		}
+		else {
+			return false;
+		}
+		return used == value.size();
+	}
+	catch (const exception&) {
+		return false;
+	}
+}
+
+/**
+ * @brief Lee parámetros de un archivo con una línea "nombre = valor" (o "nombre valor") por parámetro; '#' inicia un comentario.
+ * @param params Parámetros a modificar.
+ * @param path Ruta del archivo.
+ * @return false si el archivo no se puede abrir o alguna línea es inválida.
+ */
+inline bool load_config(Parameters& params, const string& path) {
+	ifstream file(path);
+	if (!file) {
+		cerr << "Cannot open config file: " << path << endl;
+		return false;
+	}
+	bool ok = true;
+	string line;
+	for (int number = 1; getline(file, line); ++number) {
+		line = line.substr(0, line.find('#'));
+		for (char& c : line) {
+			if (c == '=') c = ' ';
+		}
+		istringstream tokens(line);
+		string key, value, extra;
+		if (!(tokens >> key)) continue;
+		if (!(tokens >> value) || (tokens >> extra) || !set_parameter(params, key, value)) {
+			cerr << path << ":" << number << ": invalid parameter line" << endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+/**
+ * @brief Lee los parámetros de la línea de comandos: "--nombre valor" o "--config archivo".
+ * @param argc Número de argumentos.
+ * @param argv Argumentos.
+ * @param params Parámetros a modificar.
+ * @return false si algún argumento es desconocido o está incompleto.
+ */
+inline bool parse_arguments(const int& argc, char* argv[], Parameters& params) {
+	bool ok = true;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+			ok &= load_config(params, argv[++i]);
+		}
+		else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc && set_parameter(params, argv[i] + 2, argv[i + 1])) {
+			++i;
+		}
+		else {
+			cerr << "Unknown or incomplete argument: " << argv[i] << endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
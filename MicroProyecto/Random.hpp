@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file Random.hpp
+ * @brief Generador aleatorio sin estado basado en contador (Philox4x32-10).
+ *
+ * Cada bloque de números depende solo de (semilla, flujo, tick, célula), así que cualquier hilo puede
+ * generar los números de cualquier célula en cualquier orden y la simulación se reproduce con la semilla.
+ */
+
+#include <array>
+#include <cstdint>
+
+using namespace std;
+
+/** Cuatro números aleatorios de 32 bits; cada posición es un sorteo distinto de la misma célula. */
+using Random_Block = array<uint32_t, 4>;
+
+/**
+ * @enum Random_Stream
+ * @brief Flujos independientes de números aleatorios.
+ */
+enum struct Random_Stream : uint32_t {
+	Initialize,  /**< Población inicial de la cuadrícula. */
+	Tick         /**< Reglas de cada tick. */
+};
+
+/**
+ * @enum Random_Draw
+ * @brief Uso de cada posición del bloque aleatorio de una célula en un tick.
+ */
+enum Random_Draw {
+	Draw_Spawn = 0,        /**< Aparición espontánea en células vacías. */
+	Draw_Shuffle = 1,      /**< Orden aleatorio de los vecinos. */
+	Draw_Reproduction = 2  /**< Reproducción de las plantas. */
+};
+
+/**
+ * @brief Ronda de Philox4x32: dos multiplicaciones de 32x32 -> 64 bits y mezcla con la clave.
+ */
+inline void philox_round(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, const uint32_t& k0, const uint32_t& k1) {
+	const uint64_t p0 = uint64_t(0xD2511F53u) * c0;
+	const uint64_t p1 = uint64_t(0xCD9E8D57u) * c2;
+	const uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+	const uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+	c1 = uint32_t(p1);
+	c3 = uint32_t(p0);
+	c0 = n0;
+	c2 = n2;
+}
+
+/**
+ * @brief Philox4x32-10 sobre un contador de 128 bits y una clave de 64 bits.
+ */
+inline void philox(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, const uint64_t& key) {
+	uint32_t k0 = uint32_t(key);
+	uint32_t k1 = uint32_t(key >> 32);
+	for (int round = 0; round < 10; ++round) {
+		philox_round(c0, c1, c2, c3, k0, k1);
+		k0 += 0x9E3779B9u;
+		k1 += 0xBB67AE85u;
+	}
+}
+
+/**
+ * @brief Bloque aleatorio de una célula.
+ * @param seed Semilla de la simulación.
+ * @param stream Flujo del que se sortea.
+ * @param tick Tick en el que se sortea.
+ * @param cell Índice global de la célula (fila * columnas + columna).
+ * @return Cuatro números independientes.
+ */
+inline Random_Block cell_random(const uint64_t& seed, const Random_Stream& stream, const uint32_t& tick, const uint64_t& cell) {
+	uint32_t c0 = uint32_t(cell), c1 = uint32_t(cell >> 32), c2 = tick, c3 = uint32_t(stream);
+	philox(c0, c1, c2, c3, seed);
+	return { c0, c1, c2, c3 };
+}
+
+/**
+ * @brief Llena los bloques aleatorios de un tramo de células consecutivas de una fila.
+ *
+ * Las células son independientes entre sí, así que el bucle se vectoriza: cada carril SIMD
+ * calcula el Philox de una célula.
+ * @param seed Semilla de la simulación.
+ * @param stream Flujo del que se sortea.
+ * @param tick Tick en el que se sortea.
+ * @param first_cell Índice global de la primera célula del tramo.
+ * @param count Número de células del tramo.
+ * @param out Destino de los count bloques.
+ */
+inline void random_row(const uint64_t& seed, const Random_Stream& stream, const uint32_t& tick, const uint64_t& first_cell, const int& count, Random_Block* out) {
+	#pragma omp simd
+	for (int i = 0; i < count; ++i) {
+		const uint64_t cell = first_cell + uint64_t(i);
+		uint32_t c0 = uint32_t(cell), c1 = uint32_t(cell >> 32), c2 = tick, c3 = uint32_t(stream);
+		philox(c0, c1, c2, c3, seed);
+		out[i][0] = c0;
+		out[i][1] = c1;
+		out[i][2] = c2;
+		out[i][3] = c3;
+	}
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+/**
+ * @file Recorder.hpp
+ * @brief Serie de tiempo por tick: anillo SPSC sin bloqueos, hilo escritor y archivo por columnas con deltas.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Species.hpp"
+#include "Tick_Record.hpp"
+
+using namespace std;
+
+/**
+ * @struct Spsc_Ring
+ * @brief Cola circular de un productor y un consumidor, sin bloqueos.
+ * @tparam T Tipo de los elementos (copiable trivialmente).
+ * @tparam Capacity Número de elementos (potencia de 2).
+ */
+template<typename T, size_t Capacity>
+struct Spsc_Ring {
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity debe ser potencia de 2");
+
+	/** @return false si la cola está llena. Solo desde el productor. */
+	bool try_push(const T& value) {
+		const size_t tail = write.load(memory_order_relaxed);
+		if (tail - read.load(memory_order_acquire) == Capacity) {
+			return false;
+		}
+		items[tail & (Capacity - 1)] = value;
+		write.store(tail + 1, memory_order_release);
+		return true;
+	}
+
+	/** @return false si la cola está vacía. Solo desde el consumidor. */
+	bool try_pop(T& value) {
+		const size_t head = read.load(memory_order_relaxed);
+		if (head == write.load(memory_order_acquire)) {
+			return false;
+		}
+		value = items[head & (Capacity - 1)];
+		read.store(head + 1, memory_order_release);
+		return true;
+	}
+
+private:
+	alignas(64) atomic<size_t> write{ 0 };  /**< Elementos escritos por el productor. */
+	alignas(64) atomic<size_t> read{ 0 };   /**< Elementos leídos por el consumidor. */
+	array<T, Capacity> items;               /**< Elementos. */
+};
+
+/**
+ * @struct Series_Column
+ * @brief Una columna de la serie: nombre y campo de Tick_Record del que sale.
+ */
+struct Series_Column {
+	const char* name;                        /**< Nombre en el archivo y en el CSV. */
+	array<int64_t, 4> Tick_Record::* field;  /**< Campo del registro; nullptr para el tick. */
+	Species species;                         /**< Especie dentro del campo. */
+};
+
+/** Columnas que se guardan, en orden. */
+inline const array<Series_Column, 14> series_columns = {{
+	{ "tick", nullptr, Species::Empty },
+	{ "plants", &Tick_Record::population, Species::Plant },
+	{ "herbivores", &Tick_Record::population, Species::Herbivore },
+	{ "carnivores", &Tick_Record::population, Species::Carnivore },
+	{ "plant_births", &Tick_Record::births, Species::Plant },
+	{ "herbivore_births", &Tick_Record::births, Species::Herbivore },
+	{ "carnivore_births", &Tick_Record::births, Species::Carnivore },
+	{ "plant_deaths", &Tick_Record::deaths, Species::Plant },
+	{ "herbivore_deaths", &Tick_Record::deaths, Species::Herbivore },
+	{ "carnivore_deaths", &Tick_Record::deaths, Species::Carnivore },
+	{ "herbivore_moves", &Tick_Record::moves, Species::Herbivore },
+	{ "carnivore_moves", &Tick_Record::moves, Species::Carnivore },
+	{ "plants_eaten", &Tick_Record::eaten, Species::Plant },
+	{ "herbivores_eaten", &Tick_Record::eaten, Species::Herbivore }
+}};
+
+/**
+ * @struct Series_Header
+ * @brief Encabezado del archivo de la serie (versión 1).
+ *
+ * Después del encabezado van los nombres de las columnas (un byte de longitud y los caracteres) y luego
+ * bloques independientes: número de registros (uint32) y, por columna, bytes (uint32) y los valores
+ * codificados. Cada valor se guarda como la diferencia con el anterior del bloque, en zigzag y varint.
+ * Con compresión, cada columna empieza con un byte de modo: 0 para la codificación anterior, 1 para
+ * rachas de ceros, en la que cada diferencia distinta de 0 va precedida por cuántas diferencias 0 la
+ * anteceden y la columna termina con los ceros finales. Se elige el modo más corto en cada bloque.
+ */
+struct Series_Header {
+	static constexpr char expected_magic[8] = { 'E', 'C', 'O', 'S', 'E', 'R', 'I', 'E' };  /**< Firma del formato. */
+	static constexpr uint32_t current_version = 1;  /**< Versión que escribe este código. */
+
+	char magic[8];        /**< expected_magic. */
+	uint32_t version;     /**< Versión del formato. */
+	uint32_t columns;     /**< Número de columnas. */
+	uint32_t compressed;  /**< 1 si los bloques usan rachas de ceros. */
+};
+
+/** @brief Agrega un entero sin signo en varint (7 bits por byte). */
+inline void put_varint(vector<uint8_t>& bytes, uint64_t value) {
+	while (value >= 0x80) {
+		bytes.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(uint8_t(value));
+}
+
+/** @brief Lee un varint; avanza position. */
+inline uint64_t get_varint(const uint8_t* bytes, size_t& position, const size_t& size) {
+	uint64_t value = 0;
+	for (int shift = 0; position < size && shift < 64; shift += 7) {
+		const uint8_t byte = bytes[position++];
+		value |= uint64_t(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			break;
+		}
+	}
+	return value;
+}
+
+/** @return Diferencia en zigzag: los valores pequeños, positivos o negativos, quedan pequeños. */
+inline uint64_t zigzag(const int64_t& value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+/** @return Inversa de zigzag. */
+inline int64_t unzigzag(const uint64_t& value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+/**
+ * @struct Series_Recorder
+ * @brief Registra un Tick_Record por tick sin frenar la simulación.
+ *
+ * El hilo que simula solo copia el registro al anillo; un hilo escritor lo vacía, acumula bloques de
+ * block_records registros por columnas y los escribe codificados. Si el anillo se llena el productor
+ * espera al escritor (no se pierde ningún tick) y lo cuenta en stall_count().
+ */
+struct Series_Recorder {
+	static constexpr size_t ring_capacity = 1024;  /**< Registros en el anillo. */
+	static constexpr size_t block_records = 4096;  /**< Registros por bloque del archivo. */
+
+	Series_Recorder(): compressed(false), file(nullptr), failed(false), stalls(0), closing(false) {}
+
+	/**
+	 * @brief Abre el archivo, escribe el encabezado e inicia el hilo escritor.
+	 * @param path Archivo de la serie.
+	 * @param compressed Codificar las rachas de diferencias 0.
+	 * @return false (tras imprimir el motivo) si el archivo no se puede escribir.
+	 */
+	bool open(const string& path, const bool& compressed) {
+		this->path = path;
+		this->compressed = compressed;
+		file = fopen(path.c_str(), "wb");
+		if (!file) {
+			cerr << "Cannot write series: " << path << endl;
+			return false;
+		}
+		Series_Header header = {};
+		memcpy(header.magic, Series_Header::expected_magic, sizeof(header.magic));
+		header.version = Series_Header::current_version;
+		header.columns = uint32_t(series_columns.size());
+		header.compressed = compressed;
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		for (const Series_Column& column : series_columns) {
+			const uint8_t length = uint8_t(strlen(column.name));
+			ok = ok && fwrite(&length, 1, 1, file) == 1 && fwrite(column.name, 1, length, file) == length;
+		}
+		if (!ok) {
+			cerr << "Cannot write series: " << path << endl;
+			fclose(file);
+			file = nullptr;
+			return false;
+		}
+		for (vector<int64_t>& values : columns) {
+			values.reserve(block_records);
+		}
+		writer = thread(&Series_Recorder::drain, this);
+		return true;
+	}
+
+	/** @return true si open() tuvo éxito y el archivo no se cerró. */
+	bool is_open() const { return file != nullptr; }
+
+	~Series_Recorder() { close(); }
+
+	Series_Recorder(const Series_Recorder&) = delete;
+	Series_Recorder& operator=(const Series_Recorder&) = delete;
+
+	/**
+	 * @brief Agrega un registro. Solo desde un hilo a la vez (el productor).
+	 * @param record Registro del tick.
+	 */
+	void push(const Tick_Record& record) {
+		if (!file) {
+			return;
+		}
+		while (!ring.try_push(record)) {
+			stalls++;
+			this_thread::yield();
+		}
+	}
+
+	/**
+	 * @brief Escribe lo pendiente y cierra el archivo.
+	 * @return false (tras imprimir el motivo) si alguna escritura falló.
+	 */
+	bool close() {
+		if (!writer.joinable()) {
+			return !failed;
+		}
+		closing.store(true, memory_order_release);
+		writer.join();
+		failed |= fclose(file) != 0;
+		file = nullptr;
+		if (failed) {
+			cerr << "Cannot write series: " << path << endl;
+		}
+		return !failed;
+	}
+
+	/** @return Veces que el productor encontró el anillo lleno. */
+	size_t stall_count() const { return stalls; }
+
+private:
+	string path;                 /**< Archivo de la serie. */
+	bool compressed;             /**< Codificar las rachas de diferencias 0. */
+	FILE* file;                  /**< Archivo abierto. */
+	bool failed;                 /**< Alguna escritura falló (solo el hilo escritor, hasta close()). */
+	size_t stalls;               /**< Veces que el anillo estaba lleno. */
+	atomic<bool> closing;        /**< El productor terminó. */
+	Spsc_Ring<Tick_Record, ring_capacity> ring;                /**< Registros pendientes. */
+	array<vector<int64_t>, series_columns.size()> columns;     /**< Bloque en curso, por columnas. */
+	vector<uint8_t> encoded;     /**< Columna codificada del bloque en curso. */
+	thread writer;               /**< Hilo escritor. */
+
+	/** @brief Cuerpo del hilo escritor. */
+	void drain() {
+		Tick_Record record;
+		for (;;) {
+			const bool last = closing.load(memory_order_acquire);
+			bool any = false;
+			while (ring.try_pop(record)) {
+				append(record);
+				any = true;
+			}
+			if (last) {
+				break;
+			}
+			if (!any) {
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		}
+		write_block();
+	}
+
+	/** @brief Agrega un registro al bloque en curso. */
+	void append(const Tick_Record& record) {
+		for (size_t c = 0; c < series_columns.size(); ++c) {
+			const Series_Column& column = series_columns[c];
+			columns[c].push_back(column.field ? (record.*column.field)[int(column.species)] : record.tick);
+		}
+		if (columns[0].size() == block_records) {
+			write_block();
+		}
+	}
+
+	/** @brief Codifica y escribe el bloque en curso. */
+	void write_block() {
+		const uint32_t records = uint32_t(columns[0].size());
+		if (records == 0) {
+			return;
+		}
+		failed |= fwrite(&records, sizeof(records), 1, file) != 1;
+		for (vector<int64_t>& values : columns) {
+			encoded.clear();
+			encode(values, false);
+			if (compressed) {
+				const size_t plain = encoded.size();
+				encode(values, true);
+				const bool runs = encoded.size() - plain < plain;
+				encoded.erase(runs ? encoded.begin() : encoded.begin() + plain, runs ? encoded.begin() + plain : encoded.end());
+				encoded.insert(encoded.begin(), uint8_t(runs));
+			}
+			const uint32_t bytes = uint32_t(encoded.size());
+			failed |= fwrite(&bytes, sizeof(bytes), 1, file) != 1 || fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size();
+			values.clear();
+		}
+	}
+
+	/** @brief Agrega a encoded las diferencias de una columna, en varint o en rachas de ceros. */
+	void encode(const vector<int64_t>& values, const bool& runs) {
+		int64_t previous = 0;
+		uint64_t zeros = 0;
+		for (const int64_t& value : values) {
+			const uint64_t delta = zigzag(value - previous);
+			previous = value;
+			if (!runs) {
+				put_varint(encoded, delta);
+			}
+			else if (delta == 0) {
+				zeros++;
+			}
+			else {
+				put_varint(encoded, zeros);
+				put_varint(encoded, delta);
+				zeros = 0;
+			}
+		}
+		if (runs) {
+			put_varint(encoded, zeros);
+		}
+	}
+};
+
+/**
+ * @struct Series_Table
+ * @brief Serie leída de un archivo, por columnas.
+ */
+struct Series_Table {
+	vector<string> names;            /**< Nombre de cada columna. */
+	vector<vector<int64_t>> values;  /**< Valores de cada columna. */
+};
+
+/**
+ * @brief Lee un archivo de la serie.
+ * @param path Archivo de la serie.
+ * @param table Tabla de salida.
+ * @return false (tras imprimir el motivo) si el archivo no se puede leer.
+ */
+inline bool read_series(const string& path, Series_Table& table) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		cerr << "Cannot open series: " << path << endl;
+		return false;
+	}
+	Series_Header header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, Series_Header::expected_magic, sizeof(header.magic)) != 0 || header.version != Series_Header::current_version) {
+		cerr << "Invalid series file: " << path << endl;
+		fclose(file);
+		return false;
+	}
+	table.names.assign(header.columns, "");
+	table.values.assign(header.columns, {});
+	for (string& name : table.names) {
+		uint8_t length = 0;
+		char text[256];
+		if (fread(&length, 1, 1, file) != 1 || fread(text, 1, length, file) != length) {
+			cerr << "Invalid series file (column names): " << path << endl;
+			fclose(file);
+			return false;
+		}
+		name.assign(text, length);
+	}
+	uint32_t records = 0;
+	vector<uint8_t> bytes;
+	while (fread(&records, sizeof(records), 1, file) == 1) {
+		for (vector<int64_t>& values : table.values) {
+			uint32_t size = 0;
+			if (fread(&size, sizeof(size), 1, file) != 1) {
+				cerr << "Invalid series file (truncated block): " << path << endl;
+				fclose(file);
+				return false;
+			}
+			bytes.resize(size);
+			if (fread(bytes.data(), 1, size, file) != size) {
+				cerr << "Invalid series file (truncated block): " << path << endl;
+				fclose(file);
+				return false;
+			}
+			size_t position = 0;
+			const bool runs = header.compressed && size > 0 && bytes[position++] == 1;
+			int64_t previous = 0;
+			for (uint32_t r = 0; r < records;) {
+				uint64_t zeros = runs ? get_varint(bytes.data(), position, size) : 0;
+				for (; zeros > 0 && r < records; --zeros, ++r) {
+					values.push_back(previous);
+				}
+				if (r < records) {
+					previous += unzigzag(get_varint(bytes.data(), position, size));
+					values.push_back(previous);
+					++r;
+				}
+			}
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+/**
+ * @brief Escribe una serie como CSV, con una fila por tick.
+ * @param out Flujo de salida.
+ * @param table Serie leída con read_series.
+ */
+inline void write_series_csv(ostream& out, const Series_Table& table) {
+	for (size_t c = 0; c < table.names.size(); ++c) {
+		out << (c ? "," : "") << table.names[c];
+	}
+	out << '\n';
+	const size_t rows = table.values.empty() ? 0 : table.values[0].size();
+	for (size_t r = 0; r < rows; ++r) {
+		for (size_t c = 0; c < table.values.size(); ++c) {
+			out << (c ? "," : "") << table.values[c][r];
+		}
+		out << '\n';
+	}
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+/**
+ * @file Renderer.hpp
+ * @brief Dibujo de la cuadrícula en la terminal desde un búfer preasignado, escrito por un hilo aparte.
+ */
+
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Grid.hpp"
+#include "Parameters.hpp"
+#include "Statistics.hpp"
+
+using namespace std;
+
+/**
+ * @struct Frame_Renderer
+ * @brief Arma cada cuadro en un búfer de bytes y lo entrega a un hilo escritor.
+ *
+ * Con Display::Live solo se emiten las células que cambiaron desde el último cuadro, con secuencias
+ * de posicionamiento del cursor; si el escritor sigue ocupado con el cuadro anterior, el cuadro se
+ * salta (el siguiente compara contra el último cuadro entregado). Con Display::Plain cada cuadro se
+ * imprime completo, uno debajo del otro, y no se salta ninguno. En ambos casos el cuadro se entrega
+ * en tramos de filas de alrededor de chunk_bytes, así que los búferes no crecen con la cuadrícula, y
+ * el hilo que simula solo recorre la cuadrícula en memoria; espera a la terminal solo cuando el
+ * escritor sigue con el tramo anterior dentro de un mismo cuadro. Display::Live guarda además un
+ * byte por célula con lo último dibujado; si no hay memoria para eso se dibuja con Display::Plain.
+ * Quien no tiene la cuadrícula entera (el coordinador de run_distributed) arma el cuadro fila por fila
+ * con begin_frame, add_row y end_frame.
+ */
+struct Frame_Renderer {
+	/**
+	 * @brief Reserva los búferes e inicia el hilo escritor.
+	 *
+	 * Si no alcanza la memoria para recordar lo dibujado en Display::Live, avisa por cerr y dibuja
+	 * con Display::Plain.
+	 * @param rows Filas de la cuadrícula.
+	 * @param cols Columnas de la cuadrícula.
+	 * @param display Forma de dibujar.
+	 * @param out Archivo de salida.
+	 */
+	Frame_Renderer(const int& rows, const int& cols, const Display& display, FILE* out = stdout):
+		rows(rows), cols(cols), display(display), out(out), pending(false), stop(false)
+	{
+		if (display == Display::Live) {
+			try {
+				shown.assign(size_t(rows) * cols, unseen);
+			}
+			catch (const bad_alloc&) {
+				cerr << "Not enough memory for the live display of a " << rows << "x" << cols << " grid; drawing plain frames" << endl;
+				this->display = Display::Plain;
+			}
+		}
+		const size_t capacity = chunk_bytes + size_t(cols) * max_cell_bytes + 256;
+		building.reserve(capacity);
+		ready.reserve(capacity);
+		writer = thread(&Frame_Renderer::write_frames, this);
+	}
+
+	~Frame_Renderer() { close(); }
+
+	Frame_Renderer(const Frame_Renderer&) = delete;
+	Frame_Renderer& operator=(const Frame_Renderer&) = delete;
+
+	/**
+	 * @brief Arma un cuadro a partir del búfer actual y lo entrega al escritor.
+	 * @param grid Cuadrícula a dibujar.
+	 * @param record Estadísticas del tick, de las que salen los conteos.
+	 * @param last Es el cuadro final (sin encabezado de tick en Display::Plain).
+	 */
+	template<typename Grid_Type>
+	void render(const Grid_Type& grid, const Tick_Record& record, const bool& last = false) {
+		if (!begin_frame(record, last)) {
+			return;
+		}
+		const Grid_Buffer& cells = grid.current();
+		for (int i = 0; i < rows; ++i) {
+			append_row(i, [&](const int& j) { return cells[grid.index(i, j)].species(); });
+		}
+		end_frame();
+	}
+
+	/**
+	 * @brief Empieza un cuadro que se completa con add_row, en orden de filas, y end_frame.
+	 * @param record Estadísticas del tick, de las que salen los conteos.
+	 * @param last Es el cuadro final (sin encabezado de tick en Display::Plain).
+	 * @return false si el cuadro se salta (Display::Live con el escritor ocupado); entonces no se llama add_row ni end_frame.
+	 */
+	bool begin_frame(const Tick_Record& record, const bool& last = false) {
+		{
+			lock_guard<mutex> lock(guard);
+			if (pending && display == Display::Live && !last) {
+				return false;
+			}
+		}
+		building.clear();
+		if (display == Display::Live) {
+			live_header(record);
+		}
+		else {
+			plain_header(record, last);
+		}
+		return true;
+	}
+
+	/**
+	 * @brief Agrega la fila i del cuadro empezado con begin_frame.
+	 * @param i Fila de la cuadrícula.
+	 * @param row Las cols células de la fila, contiguas.
+	 */
+	void add_row(const int& i, const Cell* row) {
+		append_row(i, [row](const int& j) { return row[j].species(); });
+	}
+
+	/** @brief Termina el cuadro y lo entrega al escritor. */
+	void end_frame() {
+		if (display == Display::Live && color != Species::Empty) {
+			building += "\033[0m";
+		}
+		hand_off();
+	}
+
+	/** @brief Espera a que se escriba el último cuadro y termina el hilo escritor. */
+	void close() {
+		if (!writer.joinable()) {
+			return;
+		}
+		{
+			unique_lock<mutex> lock(guard);
+			idle.wait(lock, [this] { return !pending; });
+			if (display == Display::Live && !first) {
+				building.clear();
+				move_to(rows + header_lines + 1, 1);
+				building += "\033[?25h\n";
+				building.swap(ready);
+				pending = true;
+			}
+			stop = true;
+			work.notify_one();
+		}
+		writer.join();
+	}
+
+private:
+	static constexpr uint8_t unseen = 0xFF;      /**< Especie de una célula que todavía no se dibujó. */
+	static constexpr int header_lines = 4;       /**< Líneas de conteos sobre la cuadrícula en Display::Live. */
+	static constexpr size_t max_cell_bytes = 24; /**< Bytes más largos de una célula: posición, color, letra y reinicio. */
+	static constexpr int max_gap = 3;            /**< Células sin cambios que se redibujan antes que mover el cursor. */
+	static constexpr size_t chunk_bytes = size_t(1) << 20;  /**< Bytes de un cuadro tras los que se entrega el tramo armado. */
+
+	int rows;                 /**< Filas de la cuadrícula. */
+	int cols;                 /**< Columnas de la cuadrícula. */
+	Display display;          /**< Forma de dibujar. */
+	FILE* out;                /**< Archivo de salida. */
+	vector<uint8_t> shown;    /**< Especie dibujada en cada célula en el último cuadro entregado. */
+	bool first = true;        /**< Todavía no se entregó ningún cuadro en Display::Live. */
+	Species color = Species::Empty;  /**< Color activo en la terminal dentro del cuadro de Display::Live en armado. */
+
+	string building;          /**< Cuadro que arma el hilo que simula. */
+	string ready;             /**< Cuadro que escribe el hilo escritor. */
+	bool pending;             /**< ready tiene un cuadro sin escribir. */
+	bool stop;                /**< El escritor debe terminar después de escribir lo pendiente. */
+	mutex guard;              /**< Protege pending, stop y el intercambio de búferes. */
+	condition_variable work;  /**< Avisa al escritor que hay un cuadro o que debe terminar. */
+	condition_variable idle;  /**< Avisa al hilo que simula que el escritor terminó un cuadro. */
+	thread writer;            /**< Hilo escritor. */
+
+	/** @brief Bucle del hilo escritor. */
+	void write_frames() {
+		unique_lock<mutex> lock(guard);
+		for (;;) {
+			work.wait(lock, [this] { return pending || stop; });
+			if (pending) {
+				lock.unlock();
+				fwrite(ready.data(), 1, ready.size(), out);
+				fflush(out);
+				lock.lock();
+				pending = false;
+				idle.notify_all();
+			}
+			else if (stop) {
+				return;
+			}
+		}
+	}
+
+	/** @brief Espera a que el escritor termine lo anterior, le entrega lo armado y deja building vacío. */
+	void hand_off() {
+		{
+			unique_lock<mutex> lock(guard);
+			idle.wait(lock, [this] { return !pending; });
+			building.swap(ready);
+			pending = true;
+			work.notify_one();
+		}
+		building.clear();
+	}
+
+	/** @brief Agrega un entero al cuadro. */
+	void append_number(const int64_t& value) {
+		char digits[24];
+		const to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+		building.append(digits, result.ptr);
+	}
+
+	/** @brief Agrega la secuencia que mueve el cursor a (línea, columna), contando desde 1. */
+	void move_to(const int& line, const int& column) {
+		building += "\033[";
+		append_number(line);
+		building += ';';
+		append_number(column);
+		building += 'H';
+	}
+
+	/** @brief Agrega una célula con el formato de texto original: letra con color y un espacio. */
+	void append_cell(const Species& species) {
+		switch (species) {
+			case Species::Plant:     building += "\033[92mP\033[0m "; break;
+			case Species::Herbivore: building += "\033[94mH\033[0m "; break;
+			case Species::Carnivore: building += "\033[91mC\033[0m "; break;
+			default:                 building += "  "; break;
+		}
+	}
+
+	/** @brief Encabezado de un cuadro con el formato de texto original. */
+	void plain_header(const Tick_Record& record, const bool& last) {
+		if (!last) {
+			building += "\n\nTick: ";
+			append_number(record.tick);
+		}
+		building += "\nPlants: ";
+		append_number(record.population[int(Species::Plant)]);
+		building += "\nHerbivores: ";
+		append_number(record.population[int(Species::Herbivore)]);
+		building += "\nCarnivores: ";
+		append_number(record.population[int(Species::Carnivore)]);
+	}
+
+	/** @brief Fila completa con el formato de texto original. */
+	template<typename Get_Species>
+	void append_plain_row(const Get_Species& species_at) {
+		building += '\n';
+		for (int j = 0; j < cols; ++j) {
+			append_cell(species_at(j));
+		}
+	}
+
+	/**
+	 * @brief Agrega la fila i al cuadro en armado; lo armado se entrega al escritor cada chunk_bytes.
+	 * @param i Fila de la cuadrícula.
+	 * @param species_at Especie de la célula en la columna j de la fila.
+	 */
+	template<typename Get_Species>
+	void append_row(const int& i, const Get_Species& species_at) {
+		if (display == Display::Live) {
+			append_live_row(i, species_at);
+		}
+		else {
+			append_plain_row(species_at);
+		}
+		if (building.size() >= chunk_bytes) {
+			hand_off();
+		}
+	}
+
+	/** @brief Agrega una célula en Display::Live; el color queda activo para las células siguientes. */
+	void append_live_cell(const Species& species, Species& color) {
+		static const char* codes[] = { "", "\033[92m", "\033[94m", "\033[91m" };
+		static const char letters[] = { ' ', 'P', 'H', 'C' };
+		if (species != Species::Empty && species != color) {
+			building += codes[int(species)];
+			color = species;
+		}
+		building += letters[int(species)];
+		building += ' ';
+	}
+
+	/** @brief Encabezado de un cuadro de Display::Live, que borra la pantalla en el primero. */
+	void live_header(const Tick_Record& record) {
+		if (first) {
+			building += "\033[?25l\033[2J";
+			first = false;
+		}
+		const char* labels[header_lines] = { "Tick: ", "Plants: ", "Herbivores: ", "Carnivores: " };
+		const int64_t values[header_lines] = { record.tick, record.population[int(Species::Plant)], record.population[int(Species::Herbivore)], record.population[int(Species::Carnivore)] };
+		for (int line = 0; line < header_lines; ++line) {
+			move_to(line + 1, 1);
+			building += labels[line];
+			append_number(values[line]);
+			building += "\033[K";
+		}
+		color = Species::Empty;
+	}
+
+	/**
+	 * @brief Células de la fila i que cambiaron desde el último cuadro, en su posición de la pantalla.
+	 *
+	 * Los huecos cortos de células sin cambios se vuelven a dibujar en lugar de mover el cursor, y el
+	 * color solo se emite cuando cambia.
+	 */
+	template<typename Get_Species>
+	void append_live_row(const int& i, const Get_Species& species_at) {
+		uint8_t* previous = shown.data() + size_t(i) * cols;
+		int last = -1;  // Última columna dibujada en esta fila; el cursor está en last + 1.
+		for (int j = 0; j < cols; ++j) {
+			const uint8_t species = uint8_t(species_at(j));
+			if (species == previous[j]) {
+				continue;
+			}
+			if (last >= 0 && j - last - 1 <= max_gap) {
+				for (int k = last + 1; k < j; ++k) {
+					append_live_cell(species_at(k), color);
+				}
+			}
+			else {
+				move_to(i + header_lines + 1, 2 * j + 1);
+			}
+			append_live_cell(Species(species), color);
+			previous[j] = species;
+			last = j;
+		}
+	}
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * @file Rule_Tables.hpp
+ * @brief Tablas de las reglas: qué hace una célula según el resumen de su vecindario y sus sorteos.
+ *
+ * update_cell() consulta estas tablas en lugar de encadenar comparaciones que dependen de los datos, así
+ * que cada célula sigue casi siempre la misma ruta y el procesador no falla al predecir saltos aleatorios.
+ */
+
+#include <array>
+#include <cstdint>
+
+#include "Grid.hpp"
+#include "Parameters.hpp"
+
+using namespace std;
+
+/**
+ * @enum Animal_Action
+ * @brief Lo que hace un animal vivo en un tick.
+ */
+enum struct Animal_Action : uint8_t {
+	Stay,  /**< Se queda en su célula, con una unidad menos de energía y de hambre. */
+	Move,  /**< Se mueve a un vecino vacío, con una unidad menos de energía y de hambre. */
+	Eat    /**< Se mueve a un vecino con su presa y se la come. */
+};
+
+/** Acción de un animal, indexada por (hay presa) * 2 + (hay vecino vacío): comer tiene prioridad sobre moverse. */
+constexpr array<Animal_Action, 4> animal_actions = { Animal_Action::Stay, Animal_Action::Move, Animal_Action::Eat, Animal_Action::Eat };
+
+/**
+ * @brief Acción de un animal según su vecindario.
+ * @param prey Vecinos con su presa (un bit por dirección).
+ * @param empty Vecinos vacíos.
+ */
+inline Animal_Action animal_action(const uint8_t& prey, const uint8_t& empty) {
+	return animal_actions[(prey != 0) * 2 + (empty != 0)];
+}
+
+/** Especies de next sobre las que puede nacer la cría de un animal, indexadas por Species. */
+constexpr array<bool, 4> offspring_room = { true, true, false, false };
+
+/**
+ * @brief Umbral entero de una probabilidad: para k entero entre 0 y 99, k < umbral equivale a double(k) < rate * 100.0.
+ * @param rate Probabilidad entre 0 y 1 (fuera de ese rango se satura).
+ */
+constexpr int percent_threshold(const double& rate) {
+	const double limit = rate * 100.0;
+	if (!(limit > 0.0)) {
+		return 0;
+	}
+	if (limit >= 100.0) {
+		return 100;
+	}
+	const int whole = int(limit);
+	return whole < limit ? whole + 1 : whole;
+}
+
+/**
+ * @struct Spawn_Rule
+ * @brief Aparición espontánea en una célula vacía para un valor de Draw_Spawn % 2.
+ */
+struct Spawn_Rule {
+	Species species;  /**< Especie que aparece. */
+	int threshold;    /**< Aparece si Draw_Spawn % 100 es menor. */
+};
+
+/**
+ * @struct Rule_Tables
+ * @brief Umbrales de las reglas, calculados una vez a partir de las constantes de las especies.
+ */
+struct Rule_Tables {
+	/**
+	 * Aparición indexada por Draw_Spawn % 2. Como el resto nunca vale 2, los herbívoros no aparecen solos
+	 * (herbivore_after_spawn_rate no se usa), igual que en las reglas originales.
+	 */
+	array<Spawn_Rule, 2> spawn;
+	int plant_reproduction;  /**< Una planta se reproduce si Draw_Reproduction % 100 es menor. */
+
+	/** @brief Calcula los umbrales de unas constantes. */
+	constexpr explicit Rule_Tables(const Species_Parameters& constants)
+		: spawn{ { { Species::Plant, percent_threshold(constants.plant_after_spawn_rate) }, { Species::Carnivore, percent_threshold(constants.carnivore_after_spawn_rate) } } },
+		  plant_reproduction(percent_threshold(constants.plant_reproduction_chance)) {}
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+/**
+ * @file Scheduler.hpp
+ * @brief Reparto de los tiles de cada fase entre los hilos: colas por hilo, pesos por animales y robo de trabajo.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <omp.h>
+
+#include "Activity.hpp"
+#include "Tiles.hpp"
+
+using namespace std;
+
+/**
+ * @struct Thread_Load
+ * @brief Tiempo y trabajo de un hilo en las fases de tiles, acumulados desde el inicio de la corrida.
+ */
+struct Thread_Load {
+	double busy;     /**< Segundos actualizando tiles. */
+	double idle;     /**< Segundos buscando trabajo o esperando a los demás hilos al final de cada fase. */
+	int64_t tiles;   /**< Tiles actualizados (propios y robados). */
+	int64_t stolen;  /**< Tiles robados de la cola de otro hilo. */
+};
+
+/**
+ * @struct Tile_Scheduler
+ * @brief Colas de tiles por hilo con robo de trabajo.
+ *
+ * Al inicio del tick los tiles activos de cada fase se cortan en tramos contiguos de peso parecido, uno
+ * por hilo; el peso de un tile es su número de células más animal_cost por cada animal que tenía al
+ * final del tick anterior (un animal busca comida, lugar y pareja; una célula vacía casi no cuesta).
+ * Cada hilo toma tiles del frente de su tramo y, cuando se le acaba, roba del final del tramo de otro.
+ * El orden dentro de una fase no cambia el resultado (ver Tile_Phases).
+ */
+struct Tile_Scheduler {
+	static constexpr int animal_cost = 8;  /**< Peso de un animal respecto a una célula vacía o con planta. */
+
+	/**
+	 * @brief Reserva una cola por hilo.
+	 * @param threads Hilos de la región paralela.
+	 */
+	explicit Tile_Scheduler(const int& threads): queues(threads), loads(threads) {}
+
+	/**
+	 * @brief Reparte los tiles activos de todas las fases entre las colas. Llamar desde un solo hilo, después de Active_Tiles::classify.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param activity Tiles activos y su resumen del tick anterior.
+	 */
+	void plan(const Tile_Phases& phases, const Active_Tiles& activity) {
+		const int threads = min(omp_get_num_threads(), int(queues.size()));
+		for (int color = 0; color < Tile_Phases::colors; ++color) {
+			vector<int>& ids = order[color];
+			ids.clear();
+			weights.clear();
+			int64_t total = 0;
+			for (const Tile& tile : phases.phases[color]) {
+				if (activity.is_active(tile.id)) {
+					const int64_t weight = int64_t(tile.x1 - tile.x0) * (tile.y1 - tile.y0) + int64_t(animal_cost) * activity.states[tile.id].animals;
+					ids.push_back(tile.id);
+					weights.push_back(weight);
+					total += weight;
+				}
+			}
+			int begin = 0;
+			int64_t prefix = 0;
+			for (int k = 0; k < int(queues.size()); ++k) {
+				int end = begin;
+				if (k == threads - 1) {
+					end = int(ids.size());
+				}
+				else if (k < threads) {
+					const int64_t share = total * (k + 1) / threads;
+					while (end < int(ids.size()) && prefix + weights[end] / 2 < share) {
+						prefix += weights[end++];
+					}
+				}
+				queues[k].ranges[color].store(pack(begin, end), memory_order_relaxed);
+				begin = end;
+			}
+		}
+	}
+
+	/**
+	 * @brief Actualiza los tiles de una fase. Debe llamarse desde todos los hilos de una región omp parallel; termina con una barrera.
+	 * @param phases Tiles de la cuadrícula.
+	 * @param color Fase a actualizar.
+	 * @param work Función que actualiza un tile.
+	 */
+	template<typename Work>
+	void run(const Tile_Phases& phases, const int& color, Work&& work) {
+		const int me = omp_get_thread_num();
+		const int threads = min(omp_get_num_threads(), int(queues.size()));
+		Thread_Load& load = loads[me].load;
+		const double start = omp_get_wtime();
+		double busy = 0.0;
+		const auto update = [&](const int& position) {
+			const double begin = omp_get_wtime();
+			work(phases.tiles[order[color][position]]);
+			busy += omp_get_wtime() - begin;
+			load.tiles++;
+		};
+		for (int position; (position = take_front(queues[me].ranges[color])) >= 0;) {
+			update(position);
+		}
+		for (int k = 1; k < threads; ++k) {
+			for (int position; (position = take_back(queues[(me + k) % threads].ranges[color])) >= 0;) {
+				update(position);
+				load.stolen++;
+			}
+		}
+		#pragma omp barrier
+		load.busy += busy;
+		load.idle += omp_get_wtime() - start - busy;
+	}
+
+	/** @return Carga acumulada de cada hilo. Llamar fuera de una región paralela. */
+	vector<Thread_Load> thread_loads() const {
+		vector<Thread_Load> result;
+		for (const Thread_Slot& slot : loads) {
+			result.push_back(slot.load);
+		}
+		return result;
+	}
+
+	/** @return Fracción del tiempo de los hilos en las fases de tiles que se pasó sin trabajo. */
+	double idle_fraction() const {
+		double busy = 0.0;
+		double idle = 0.0;
+		for (const Thread_Slot& slot : loads) {
+			busy += slot.load.busy;
+			idle += slot.load.idle;
+		}
+		return busy + idle > 0.0 ? idle / (busy + idle) : 0.0;
+	}
+
+	/**
+	 * @brief Escribe una tabla con la carga de cada hilo.
+	 * @param out Flujo de salida.
+	 */
+	void report(ostream& out) const {
+		out << "thread      busy_s      idle_s    tiles   stolen" << endl;
+		for (size_t k = 0; k < loads.size(); ++k) {
+			const Thread_Load& load = loads[k].load;
+			out << setw(6) << k << fixed << setprecision(3) << setw(12) << load.busy << setw(12) << load.idle
+				<< setw(9) << load.tiles << setw(9) << load.stolen << endl;
+		}
+		out << "idle fraction: " << setprecision(3) << idle_fraction() << defaultfloat << endl;
+	}
+
+private:
+	/**
+	 * @struct Queue
+	 * @brief Tramo de cada fase que le toca a un hilo, [frente, final) empaquetado en 64 bits, en su propia línea de caché.
+	 */
+	struct alignas(64) Queue {
+		atomic<uint64_t> ranges[Tile_Phases::colors];  /**< Frente en los 32 bits bajos, final en los altos. */
+	};
+
+	/**
+	 * @struct Thread_Slot
+	 * @brief Carga de un hilo en su propia línea de caché.
+	 */
+	struct alignas(64) Thread_Slot {
+		Thread_Load load{};  /**< Carga acumulada. */
+	};
+
+	vector<Queue> queues;                         /**< Una cola por hilo. */
+	vector<Thread_Slot> loads;                    /**< Carga de cada hilo. */
+	vector<int> order[Tile_Phases::colors];       /**< Tiles activos de cada fase (Tile::id), en el orden de los tramos. */
+	vector<int64_t> weights;                      /**< Pesos de la fase que se está repartiendo. */
+
+	static uint64_t pack(const int& front, const int& back) { return uint64_t(uint32_t(front)) | (uint64_t(uint32_t(back)) << 32); }
+
+	/** @return Posición tomada del frente de un tramo (el hilo dueño), o -1 si está vacío. */
+	static int take_front(atomic<uint64_t>& range) {
+		uint64_t value = range.load(memory_order_relaxed);
+		for (;;) {
+			const int front = int(uint32_t(value));
+			const int back = int(value >> 32);
+			if (front >= back) {
+				return -1;
+			}
+			if (range.compare_exchange_weak(value, pack(front + 1, back), memory_order_relaxed)) {
+				return front;
+			}
+		}
+	}
+
+	/** @return Posición robada del final de un tramo, o -1 si está vacío. */
+	static int take_back(atomic<uint64_t>& range) {
+		uint64_t value = range.load(memory_order_relaxed);
+		for (;;) {
+			const int front = int(uint32_t(value));
+			const int back = int(value >> 32);
+			if (front >= back) {
+				return -1;
+			}
+			if (range.compare_exchange_weak(value, pack(front, back - 1), memory_order_relaxed)) {
+				return back - 1;
+			}
+		}
+	}
+};
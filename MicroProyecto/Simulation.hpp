@@ -0,0 +1,781 @@
+#pragma once
+
+/**
+ * @file Simulation.hpp
+ * @brief Reglas del ecosistema y avance de un tick sobre la cuadrícula.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include <omp.h>
+
+#include "Activity.hpp"
+#include "Bitplanes.hpp"
+#include "Grid.hpp"
+#include "Halo.hpp"
+#include "Neighbors.hpp"
+#include "Parameters.hpp"
+#include "Random.hpp"
+#include "Rule_Tables.hpp"
+#include "Scheduler.hpp"
+#include "Species_Policy.hpp"
+#include "Statistics.hpp"
+#include "Tiles.hpp"
+
+using namespace std;
+
+/**
+ * @struct Runtime_Rules
+ * @brief Reglas con las constantes leídas en tiempo de ejecución; sirven para cualquier configuración.
+ */
+struct Runtime_Rules {
+	Species_Parameters constants;  /**< Constantes de las especies. */
+	Rule_Tables tables;            /**< Umbrales calculados a partir de constants. */
+};
+
+/**
+ * @struct Static_Rules
+ * @brief Reglas con las constantes fijadas al compilar: el compilador las pliega dentro de update_cell.
+ * @tparam P Constantes de las especies.
+ */
+template<Species_Parameters P>
+struct Static_Rules {
+	static constexpr Species_Parameters constants = P;  /**< Constantes de las especies. */
+	static constexpr Rule_Tables tables = Rule_Tables(P);  /**< Umbrales calculados a partir de constants. */
+};
+
+/**
+ * @struct Rules_Catalog
+ * @brief Lista de configuraciones que tienen su propia instancia compilada de las reglas.
+ */
+template<Species_Parameters... Known>
+struct Rules_Catalog {};
+
+/** Configuraciones de uso diario. Añadir una aquí cuesta una instancia más de los kernels al compilar. */
+using Common_Configurations = Rules_Catalog<Species_Parameters{}>;
+
+/**
+ * @brief Llama a una función con las reglas de una configuración.
+ *
+ * Si las constantes coinciden con alguna configuración del catálogo se usa Static_Rules; si no,
+ * Runtime_Rules. Ambas dan exactamente el mismo resultado.
+ * @param species Constantes de las especies.
+ * @param function Función genérica que recibe las reglas.
+ */
+template<Species_Parameters... Known, typename Function>
+void with_rules(Rules_Catalog<Known...>, const Species_Parameters& species, Function&& function) {
+	const bool compiled = ((species == Known ? (function(Static_Rules<Known>{}), true) : false) || ...);
+	if (!compiled) {
+		function(Runtime_Rules{ species, Rule_Tables(species) });
+	}
+}
+
+/** @copydoc with_rules(Rules_Catalog<Known...>, const Species_Parameters&, Function&&) */
+template<typename Function>
+void with_rules(const Species_Parameters& species, Function&& function) {
+	with_rules(Common_Configurations{}, species, function);
+}
+
+/**
+ * @brief Comprueba que los parámetros tengan sentido y que las constantes quepan en Cell.
+ * @param params Parámetros a comprobar.
+ * @return false (tras imprimir el motivo) si algún parámetro es inválido.
+ */
+inline bool validate_parameters(const Parameters& params) {
+	const Species_Parameters& species = params.species;
+	bool ok = true;
+	const auto check = [&](const bool& condition, const char* message) {
+		if (!condition) {
+			cerr << "Invalid parameters: " << message << endl;
+			ok = false;
+		}
+	};
+	check(params.rows > 0 && params.cols > 0, "the grid needs at least one row and one column");
+	check(params.ticks >= 0, "ticks must not be negative");
+	check(params.tick_update > 0, "tick-update must be positive");
+	check(params.threads > 0, "threads must be positive");
+	check(params.tile_size > 0, "tile-size must be positive");
+	check(params.repeats > 0, "repeats must be positive");
+	check(params.max_threads >= 0, "max-threads must not be negative");
+	check(params.checkpoint_every >= 0, "checkpoint-every must not be negative");
+	check(params.processes > 0, "processes must be positive");
+	check(params.runs > 0, "runs must be positive");
+	check(params.temporal_block > 0, "temporal-block must be positive");
+	if (!params.storage.empty()) {
+#ifdef _WIN32
+		check(false, "out-of-core storage needs mmap");
+#endif
+		check(params.layout == Grid_Layout::Rows, "out-of-core storage needs the rows layout");
+	}
+	if (!params.ensemble.empty()) {
+		check(params.checkpoint.empty() && params.restore.empty() && params.series.empty(), "ensembles do not write checkpoints or series");
+		check(params.benchmark == Benchmark::None && params.processes == 1, "ensembles need a single process and no benchmark");
+	}
+	if (!params.zones.empty() || !params.heatmap.empty()) {
+		check(params.zones.empty() || !params.zone_report.empty(), "zones need a zone-report file");
+		check(params.heatmap_block > 0, "heatmap-block must be positive");
+		check(params.processes == 1 && params.ensemble.empty(), "zones and heatmaps need a single run in a single process");
+		check(int64_t(params.rows) * params.cols <= int64_t(UINT32_MAX), "zones and heatmaps need at most 2^32 - 1 cells");
+	}
+	if (params.temporal_block > 1) {
+		check(params.schedule == Schedule::Tiles && params.border == Border::Walls, "temporal-block needs the tiles schedule and the walls border");
+		check(params.processes == 1 && params.ensemble.empty(), "temporal-block needs a single run in a single process");
+		check(params.zones.empty() && params.heatmap.empty(), "zones and heatmaps need temporal-block 1");
+	}
+	if (params.processes > 1) {
+		check(params.schedule == Schedule::Tiles, "processes > 1 needs the tiles schedule");
+		check(params.rows >= params.processes * max(params.tile_size, 2), "each process needs at least one row of tiles");
+		check(params.checkpoint.empty() && params.restore.empty(), "checkpoints need a single process");
+		check(params.benchmark == Benchmark::None, "benchmarks need a single process");
+		check(params.border == Border::Walls, "the torus border needs a single process");
+		check(params.layout == Grid_Layout::Rows, "processes > 1 needs the rows layout");
+	}
+	if (params.border == Border::Torus && params.schedule == Schedule::Tiles) {
+		// Dos tiles del mismo color a ambos lados de la unión no deben tocar las mismas células.
+		const int size = max(params.tile_size, 2);
+		const auto fits = [&](const int& cells) {
+			const int tiles = (cells + size - 1) / size;
+			return (tiles == 1 || tiles % 2 == 0) && cells % size != 1;
+		};
+		check(fits(params.rows) && fits(params.cols), "the torus border needs an even number of tiles per side (or one) and no last tile of width 1");
+	}
+	check(species.max_plant_age < Cell::max_age && species.max_herbivore_age < Cell::max_age && species.max_carnivore_age < Cell::max_age, "maximum ages must be below 255");
+	check(species.herbivore_satiation <= Cell::max_hunger && species.carnivore_satiation <= Cell::max_hunger, "satiation must be at most 63");
+	check(species.herbivore_energy <= Cell::max_energy && species.carnivore_energy <= Cell::max_energy, "starting energy must be at most 65535");
+	check(species.herbivore_reproduction_energy <= Cell::max_energy && species.carnivore_reproduction_energy <= Cell::max_energy, "reproduction energy must be at most 65535");
+	return ok;
+}
+
+/**
+ * @brief Célula recién nacida de una especie fija al compilar, con la energía y la saciedad iniciales.
+ * @param rules Reglas de las que salen las constantes.
+ * @param birth Primer tick que procesa a la célula (el siguiente al que la crea); las plantas lo guardan.
+ * @tparam S Especie de la célula.
+ */
+template<Species S, typename Rules>
+Cell newborn(const Rules& rules, const int& birth = 0) {
+	Cell cell(S);
+	if constexpr (S == Species::Plant) {
+		cell.set_birth(birth);
+	}
+	else if constexpr (S != Species::Empty) {
+		const Animal_Constants constants = Species_Policy<S>::constants(rules.constants);
+		cell.set_energy(constants.energy);
+		cell.set_hunger(constants.satiation);
+	}
+	return cell;
+}
+
+/**
+ * @brief Célula recién nacida de una especie elegida en tiempo de ejecución.
+ * @param species Especie de la célula.
+ * @param rules Reglas de las que salen las constantes.
+ * @param birth Primer tick que procesa a la célula (el siguiente al que la crea); las plantas lo guardan.
+ */
+template<typename Rules>
+Cell newborn(const Species& species, const Rules& rules, const int& birth = 0) {
+	switch (species) {
+		case Species::Plant: return newborn<Species::Plant>(rules, birth);
+		case Species::Herbivore: return newborn<Species::Herbivore>(rules, birth);
+		case Species::Carnivore: return newborn<Species::Carnivore>(rules, birth);
+		default: return newborn<Species::Empty>(rules, birth);
+	}
+}
+
+/**
+ * @struct Basic_Ecosystem
+ * @brief Estado completo de una corrida: parámetros, cuadrícula y estructuras auxiliares.
+ * @tparam Layout Orden de las células en memoria (Row_Major_Layout o Morton_Layout).
+ */
+template<typename Layout>
+struct Basic_Ecosystem {
+	Parameters params;     /**< Parámetros de la corrida. */
+	Basic_Grid<Layout> grid; /**< Cuadrícula que representa el ecosistema. */
+	Tile_Phases phases;    /**< Tiles de la cuadrícula por fase de color. */
+	Bitplanes planes;      /**< Planos de bits de grid.current(). */
+	optional<Bitplanes> spare_planes; /**< Planos de bits de grid.next() para los ticks de advance_block; vacío si params.temporal_block es 1. */
+	Active_Tiles activity; /**< Tiles activos y su resumen. */
+	Tile_Scheduler scheduler; /**< Reparto de los tiles de cada fase entre los hilos. */
+	Population_Stats stats; /**< Población por especie, actualizada en cada tick. */
+	int tick;              /**< Ticks completados. */
+	Halo_Links* halo;      /**< Intercambio con las franjas vecinas, o nullptr si el proceso tiene toda la cuadrícula. Solo con Row_Major_Layout. */
+	bool halo_lost;        /**< Se perdió la conexión con una franja vecina: advance() dejó el tick a medias y la franja debe terminar. */
+	Grid_Buffer* retire;   /**< Recibe el búfer actual en el próximo swap_grid() (ver Checkpoint_Writer), o nullptr. */
+
+	/**
+	 * @brief Reserva una cuadrícula vacía para unos parámetros.
+	 * @param params Parámetros de la corrida.
+	 */
+	explicit Basic_Ecosystem(const Parameters& params): Basic_Ecosystem(params, Stripe{ 0, params.rows, false, false }) {}
+
+	/**
+	 * @brief Reserva solo una franja de la cuadrícula, con sus filas de halo (ver Distributed.hpp).
+	 *
+	 * Las células conservan su índice de la cuadrícula completa en los sorteos, así que cada franja
+	 * evoluciona igual que en un solo proceso. Los tiles junto a un borde con otra franja se procesan siempre.
+	 * @param params Parámetros de la corrida completa.
+	 * @param stripe Filas del proceso.
+	 */
+	Basic_Ecosystem(const Parameters& params, const Stripe& stripe):
+		Basic_Ecosystem(params, stripe, Basic_Grid<Layout>(stripe.local_rows(), params.cols, stripe.row_offset(), params.storage, params.threads)) {}
+
+	/**
+	 * @brief Arma el ecosistema sobre una cuadrícula completa ya llena (ver Snapshot_Reader::grid).
+	 * @param params Parámetros de la corrida.
+	 * @param source Cuadrícula de params.rows x params.cols.
+	 */
+	Basic_Ecosystem(const Parameters& params, Basic_Grid<Layout>&& source): Basic_Ecosystem(params, Stripe{ 0, params.rows, false, false }, move(source)) {}
+
+	/**
+	 * @brief Arma el ecosistema de una franja sobre su cuadrícula.
+	 * @param params Parámetros de la corrida completa.
+	 * @param stripe Filas del proceso.
+	 * @param source Cuadrícula de la franja, con sus filas de halo.
+	 */
+	Basic_Ecosystem(const Parameters& params, const Stripe& stripe, Basic_Grid<Layout>&& source):
+		params(params),
+		grid(move(source)),
+		phases(stripe.local_rows(), params.cols, params.tile_size, stripe.halo_top, stripe.halo_top + stripe.owned_rows(), stripe.row_offset()),
+		planes(grid, params.border == Border::Torus, params.storage, params.threads),
+		activity(phases, params.species, params.border == Border::Torus),
+		scheduler(params.threads),
+		stats(params.threads, params.temporal_block),
+		tick(0),
+		halo(nullptr),
+		halo_lost(false),
+		retire(nullptr)
+	{
+		if (params.temporal_block > 1) {
+			spare_planes.emplace(grid, false, params.storage, params.threads);
+		}
+		if (stripe.halo_top) {
+			activity.pin_row(phases, 0);
+		}
+		if (stripe.halo_bottom) {
+			activity.pin_row(phases, phases.tiles_x - 1);
+		}
+	}
+
+	/** @brief Intercambia los búferes de la cuadrícula; si hay un búfer en retire, el que deja de ser actual queda en él. Desde un solo hilo. */
+	void swap_grid() {
+		if (retire) {
+			grid.swap(*retire);
+			activity.forget_idle();
+			retire = nullptr;
+		}
+		else {
+			grid.swap();
+		}
+	}
+
+	/**
+	 * @brief Pide al disco las células y los planos que leerá una fila de tiles, con su halo, si viven en archivos mapeados.
+	 * @param tx Fila de tiles (local); fuera de rango no hace nada.
+	 */
+	void prefetch_tile_row(const int& tx) const {
+		if (params.storage.empty() || tx < 0 || tx >= phases.tiles_x) {
+			return;
+		}
+		const Tile& tile = phases.tiles[size_t(tx) * phases.tiles_y];
+		grid.prefetch_rows(tile.x0 - 1, tile.x1 + 1);
+		planes.prefetch_rows(tile.x0 - 1, tile.x1 + 1);
+	}
+};
+
+/** @brief Ecosistema con las células fila por fila, el único que se puede repartir en franjas. */
+using Ecosystem = Basic_Ecosystem<Row_Major_Layout>;
+
+/**
+ * @brief Llama a una función con el orden de las células elegido en los parámetros.
+ * @param layout Orden elegido.
+ * @param function Función que recibe type_identity<Layout>.
+ */
+template<typename Function>
+void with_layout(const Grid_Layout& layout, Function&& function) {
+	if (layout == Grid_Layout::Morton) {
+		function(type_identity<Morton_Layout<>>{});
+	}
+	else {
+		function(type_identity<Row_Major_Layout>{});
+	}
+}
+
+/**
+ * @brief Inicializa la cuadrícula con especies distribuidas aleatoriamente. Llamar fuera de una región paralela.
+ *
+ * Las filas se reparten entre params.threads hilos con el mismo omp for estático con el que se
+ * reservó la cuadrícula, así que cada hilo escribe las páginas que ya tocó. Cada célula sortea con
+ * Philox a partir de su índice global, así que el resultado no depende del número de hilos.
+ * @param ecosystem Ecosistema a inicializar.
+ * @param rules Reglas de las que salen las constantes.
+ */
+template<typename Layout, typename Rules>
+void initialize_grid(Basic_Ecosystem<Layout>& ecosystem, const Rules& rules) {
+	Basic_Grid<Layout>& grid = ecosystem.grid;
+	Grid_Buffer& cells = grid.current();
+	#pragma omp parallel num_threads(ecosystem.params.threads)
+	{
+		vector<Random_Block> randoms(grid.cols);
+		#pragma omp for schedule(static)
+		for (int i = 0; i < grid.rows; ++i) {
+			random_row(ecosystem.params.seed, Random_Stream::Initialize, 0, grid.cell_id(i, 0), grid.cols, randoms.data());
+			for (int j = 0; j < grid.cols; ++j) {
+				const size_t index = grid.index(i, j);
+				const Random_Block& random = randoms[j];
+				cells[index] = Cell(Species::Empty);
+				if (double(random[0] % 100) < (rules.constants.plant_spawn_rate * 100.0)) {
+					cells[index] = newborn(Species::Plant, rules);
+				}
+				if (double(random[1] % 100) < (rules.constants.carnivore_spawn_rate * 100.0)) {
+					cells[index] = newborn(Species::Carnivore, rules);
+				}
+				if (double(random[2] % 100) < (rules.constants.herbivore_spawn_rate * 100.0)) {
+					cells[index] = newborn(Species::Herbivore, rules);
+				}
+			}
+		}
+	}
+	ecosystem.stats.start(grid, 0, ecosystem.phases.x_begin, ecosystem.phases.x_end);
+}
+
+/**
+ * @brief Actualiza una célula vacía: puede aparecer una planta o un carnívoro.
+ *
+ * Los parámetros de todos los kernels de especie son los de update_cell(); las decisiones salen de
+ * tablas (ver Rule_Tables.hpp) indexadas por el resumen del vecindario y por los sorteos.
+ */
+template<typename Grid_Type, typename Rules>
+void update_empty(Grid_Type& grid, const int& x, const int& y, const int& tick, const Random_Block& random, const Rules& rules, Population_Delta& delta) {
+	const uint32_t spawn = random[Draw_Spawn];
+	const Spawn_Rule& rule = rules.tables.spawn[spawn % 2];
+	if (int(spawn % 100) < rule.threshold) {
+		place(grid.next(), grid.index(x, y), newborn(rule.species, rules, tick + 1), delta);
+		delta.births[int(rule.species)]++;
+	}
+}
+
+/**
+ * @brief Actualiza una planta: muere de vieja o puede reproducirse en un vecino vacío.
+ * @copydetails update_empty
+ */
+template<typename Neighbors, typename Grid_Type, typename Rules>
+void update_plant(Grid_Type& grid, const int& x, const int& y, const int& tick, const Random_Block& random, const Neighborhood& hood, const Rules& rules, Population_Delta& delta) {
+	Grid_Buffer& next = grid.next();
+	const size_t index = grid.index(x, y);
+	if (grid.current()[index].plant_age(tick) > rules.constants.max_plant_age) {
+		place(next, index, Cell(Species::Empty), delta);
+		return;
+	}
+	if (next[index].species() != Species::Plant) {
+		// Un herbívoro ya se comió la planta en next; envejece por ella, como cuando se escribía la edad.
+		next[index].grow_older();
+	}
+	if (int(random[Draw_Reproduction] % 100) < rules.tables.plant_reproduction) {
+		const Neighbors neighbors(grid, x, y, random[Draw_Shuffle]);
+		const int k = neighbors.first(hood.empty);
+		if (k >= 0) {
+			place(next, neighbors.index(grid, k), newborn<Species::Plant>(rules, tick + 1), delta);
+			delta.births[int(Species::Plant)]++;
+		}
+	}
+}
+
+/**
+ * @brief Actualiza un animal con la política de su especie: muere, come, se mueve o se queda, y puede reproducirse.
+ * @copydetails update_empty
+ * @tparam S Especie del animal (con su Species_Policy).
+ */
+template<Species S, typename Neighbors, typename Grid_Type, typename Rules>
+void update_animal(Grid_Type& grid, const int& x, const int& y, const int& tick, const Random_Block& random, const Neighborhood& hood, const Rules& rules, Population_Delta& delta) {
+	using Policy = Species_Policy<S>;
+	const Animal_Constants constants = Policy::constants(rules.constants);
+	const Grid_Buffer& current = grid.current();
+	Grid_Buffer& next = grid.next();
+	const size_t index = grid.index(x, y);
+	const Cell current_cell = current[index];
+	if ((current_cell.energy() <= 0) | (current_cell.age() > constants.max_age) | (current_cell.hunger() <= 0)) {
+		place(next, index, Cell(Species::Empty), delta);
+		return;
+	}
+	next[index].grow_older();
+
+	const Neighbors neighbors(grid, x, y, random[Draw_Shuffle]);
+	const uint8_t prey = Policy::prey_mask(hood);
+	const Animal_Action action = animal_action(prey, hood.empty);
+	if (action != Animal_Action::Eat) {
+		next[index].add_energy(-1);
+		next[index].add_hunger(-1);
+	}
+	if (action != Animal_Action::Stay) {
+		const size_t n = neighbors.index(grid, neighbors.first(action == Animal_Action::Eat ? prey : hood.empty));
+		place(next, n, current_cell, delta);
+		delta.moves[int(S)]++;
+		if (action == Animal_Action::Eat) {
+			delta.eaten[int(Policy::prey)]++;
+			if constexpr (Policy::absorbs_prey) {
+				next[n].add_energy(constants.energy_gain + current[n].energy());
+			}
+			else {
+				next[n].add_energy(constants.energy_gain);
+			}
+			next[n].set_hunger(constants.satiation);
+		}
+		place(next, index, Cell(Species::Empty), delta);
+	}
+
+	if (current_cell.energy() >= constants.reproduction_energy) {
+		// La cría nace en el primer vecino, en el orden aleatorio, que en next esté vacío o tenga una planta.
+		uint32_t room = 0;
+		for (int d = 0; d < 8; ++d) {
+			room |= uint32_t(offspring_room[int(next[neighbors.index(grid, d)].species())]) << d;
+		}
+		const int k = neighbors.first(uint8_t(room));
+		if (k >= 0) {
+			place(next, neighbors.index(grid, k), newborn<S>(rules, tick + 1), delta);
+			delta.births[int(S)]++;
+			next[index].add_energy(-constants.reproduction_energy_loss);
+		}
+	}
+}
+
+/**
+ * @brief Actualiza una célula cuya especie se conoce al compilar, con el kernel de esa especie.
+ * @copydetails update_empty
+ * @tparam S Especie de la célula en grid.current().
+ */
+template<Species S, typename Neighbors, typename Grid_Type, typename Rules>
+void update_species(Grid_Type& grid, const int& x, const int& y, const int& tick, const Random_Block& random, const Neighborhood& hood, const Rules& rules, Population_Delta& delta) {
+	if constexpr (S == Species::Empty) {
+		update_empty(grid, x, y, tick, random, rules, delta);
+	}
+	else if constexpr (S == Species::Plant) {
+		update_plant<Neighbors>(grid, x, y, tick, random, hood, rules, delta);
+	}
+	else {
+		update_animal<S, Neighbors>(grid, x, y, tick, random, hood, rules, delta);
+	}
+}
+
+/**
+ * @brief Actualiza el estado de una célula en la cuadrícula, eligiendo el kernel de su especie.
+ * @param grid Cuadrícula; se lee de grid.current() y se escribe en grid.next().
+ * @param x Coordenada x de la célula.
+ * @param y Coordenada y de la célula.
+ * @param tick Tick que se calcula.
+ * @param random Bloque aleatorio de la célula en este tick (ver Random_Draw).
+ * @param hood Ocupación de los vecinos en grid.current(), tomada de los planos de bits.
+ * @param rules Reglas de las que salen las constantes (Static_Rules o Runtime_Rules).
+ * @param delta Cambios de población del hilo que llama.
+ * @tparam Neighbors Orden de los vecinos; Moore_Neighbors no usa memoria dinámica.
+ */
+template<typename Neighbors = Moore_Neighbors, typename Grid_Type, typename Rules>
+void update_cell(Grid_Type& grid, const int& x, const int& y, const int& tick, const Random_Block& random, const Neighborhood& hood, const Rules& rules, Population_Delta& delta) {
+	switch (grid.current()[grid.index(x, y)].species()) {
+		case Species::Empty: update_species<Species::Empty, Neighbors>(grid, x, y, tick, random, hood, rules, delta); break;
+		case Species::Plant: update_species<Species::Plant, Neighbors>(grid, x, y, tick, random, hood, rules, delta); break;
+		case Species::Herbivore: update_species<Species::Herbivore, Neighbors>(grid, x, y, tick, random, hood, rules, delta); break;
+		case Species::Carnivore: update_species<Species::Carnivore, Neighbors>(grid, x, y, tick, random, hood, rules, delta); break;
+	}
+}
+
+/**
+ * @brief Actualiza un tramo de células consecutivas de una fila que tienen todas la misma especie.
+ *
+ * Las células vacías no leen el vecindario, así que para ellas no se arman las máscaras.
+ * @param grid Cuadrícula; se lee de current() y se escribe en next().
+ * @param x Fila del tramo.
+ * @param j0 Columna de la célula 0 de randoms y de las palabras de vecinos.
+ * @param first Primera célula del tramo (relativa a j0).
+ * @param last Célula siguiente a la última.
+ * @param tick Tick actual.
+ * @param randoms Bloques aleatorios de las células desde j0.
+ * @param words Vecinos vacíos, con planta y con herbívoro de las células desde j0.
+ * @param rules Reglas de las que salen las constantes.
+ * @param delta Cambios de población del hilo que llama.
+ * @tparam S Especie de las células del tramo.
+ */
+template<Species S, typename Neighbors, typename Grid_Type, typename Rules>
+void update_run(Grid_Type& grid, const int& x, const int& j0, const int& first, const int& last, const int& tick,
+	const Random_Block* randoms, const array<Neighbor_Words, 3>& words, const Rules& rules, Population_Delta& delta) {
+	for (int j = first; j < last; ++j) {
+		Neighborhood hood = {};
+		if constexpr (S != Species::Empty) {
+			hood = { words[0].mask(j), words[1].mask(j), words[2].mask(j) };
+		}
+		update_species<S, Neighbors>(grid, x, j0 + j, tick, randoms[j], hood, rules, delta);
+	}
+}
+
+/**
+ * @brief Actualiza todas las células de un tile, fila por fila.
+ *
+ * Cada tramo de 64 células se corta, con los planos de bits, en tramos de una sola especie, y cada uno
+ * se procesa con el kernel de su especie: se elige el kernel una vez por tramo y no una vez por célula,
+ * y las células se siguen recorriendo en el mismo orden.
+ * @param grid Cuadrícula (o Grid_View); se lee de current() y se escribe en next().
+ * @param planes Planos de bits de grid.current().
+ * @param seed Semilla de la corrida.
+ * @param tile Tile a actualizar.
+ * @param tick Tick actual.
+ * @param rules Reglas de las que salen las constantes.
+ * @param delta Cambios de población del hilo que llama.
+ */
+template<typename Neighbors = Moore_Neighbors, typename Grid_Type, typename Rules>
+void update_tile(Grid_Type& grid, const Bitplanes& planes, const uint64_t& seed, const Tile& tile, const int& tick, const Rules& rules, Population_Delta& delta) {
+	Random_Block randoms[64];
+	for (int i = tile.x0; i < tile.x1; ++i) {
+		for (int j0 = tile.y0; j0 < tile.y1; j0 += 64) {
+			const int count = min(64, tile.y1 - j0);
+			random_row(seed, Random_Stream::Tick, uint32_t(tick), grid.cell_id(i, j0), count, randoms);
+			const array<Neighbor_Words, 3> words = {
+				planes.neighbor_words(Species::Empty, i, j0),
+				planes.neighbor_words(Species::Plant, i, j0),
+				planes.neighbor_words(Species::Herbivore, i, j0)
+			};
+			// Los dos bits de la especie de cada célula, y un bit k por cada célula k cuya especie difiere de la k + 1.
+			const uint64_t carnivores = planes.bits64(Species::Carnivore, i, j0);
+			const uint64_t low = planes.bits64(Species::Plant, i, j0) | carnivores;
+			const uint64_t high = planes.bits64(Species::Herbivore, i, j0) | carnivores;
+			uint64_t changes = ((low ^ (low >> 1)) | (high ^ (high >> 1))) & ((uint64_t(1) << (count - 1)) - 1);
+			for (int first = 0; first < count;) {
+				const int last = changes ? countr_zero(changes) + 1 : count;
+				changes &= changes - 1;
+				switch (Species(((low >> first) & 1u) | (((high >> first) & 1u) << 1))) {
+					case Species::Empty: update_run<Species::Empty, Neighbors>(grid, i, j0, first, last, tick, randoms, words, rules, delta); break;
+					case Species::Plant: update_run<Species::Plant, Neighbors>(grid, i, j0, first, last, tick, randoms, words, rules, delta); break;
+					case Species::Herbivore: update_run<Species::Herbivore, Neighbors>(grid, i, j0, first, last, tick, randoms, words, rules, delta); break;
+					case Species::Carnivore: update_run<Species::Carnivore, Neighbors>(grid, i, j0, first, last, tick, randoms, words, rules, delta); break;
+				}
+				first = last;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Actualiza todas las células de un tile del ecosistema (ver la versión con cuadrícula y planos).
+ * @param ecosystem Ecosistema; se lee de grid.current() y se escribe en grid.next().
+ * @param tile Tile a actualizar.
+ * @param tick Tick actual.
+ * @param rules Reglas de las que salen las constantes.
+ * @param delta Cambios de población del hilo que llama.
+ */
+template<typename Neighbors = Moore_Neighbors, typename Layout, typename Rules>
+void update_tile(Basic_Ecosystem<Layout>& ecosystem, const Tile& tile, const int& tick, const Rules& rules, Population_Delta& delta) {
+	update_tile<Neighbors>(ecosystem.grid, ecosystem.planes, ecosystem.params.seed, tile, tick, rules, delta);
+}
+
+/**
+ * @brief Avanza un tick. Debe llamarse desde todos los hilos de una región omp parallel.
+ *
+ * Con Schedule::Tiles solo se copian, procesan y vuelven a resumir los tiles activos, repartidos entre
+ * los hilos por ecosystem.scheduler. Si el ecosistema
+ * es una franja, después de cada fase se intercambian las filas de borde con las franjas vecinas. Con
+ * params.storage, el primer tile de cada fila en una fase pide al disco la siguiente fila de la misma
+ * paridad, que es la que los hilos toman a continuación.
+ * Al terminar, ecosystem.planes describe el nuevo búfer actual y ecosystem.stats tiene el registro del tick.
+ * @param ecosystem Ecosistema a avanzar.
+ * @param tick Tick a calcular.
+ * @param rules Reglas de las que salen las constantes.
+ * @tparam Neighbors Lista de vecinos usada por update_cell con bordes cerrados; con Border::Torus se usa Torus_Neighbors.
+ */
+template<typename Neighbors = Moore_Neighbors, typename Layout, typename Rules>
+void advance(Basic_Ecosystem<Layout>& ecosystem, const int& tick, const Rules& rules) {
+	constexpr bool striped = is_same_v<Layout, Row_Major_Layout>;
+	Basic_Grid<Layout>& grid = ecosystem.grid;
+	Bitplanes& planes = ecosystem.planes;
+	const Tile_Phases& phases = ecosystem.phases;
+	Active_Tiles& activity = ecosystem.activity;
+	Population_Delta& delta = ecosystem.stats.local();
+	const bool torus = ecosystem.params.border == Border::Torus;
+	const bool out_of_core = !ecosystem.params.storage.empty();
+	if (ecosystem.params.schedule == Schedule::Tiles) {
+		activity.classify(phases, tick);
+		activity.sync(grid, phases);
+		#pragma omp single
+		{
+			ecosystem.scheduler.plan(phases, activity);
+			if constexpr (striped) {
+				if (ecosystem.halo) {
+					ecosystem.halo->begin_tick(grid);
+				}
+			}
+		}
+		for (int color = 0; color < Tile_Phases::colors; ++color) {
+			ecosystem.scheduler.run(phases, color, [&](const Tile& tile) {
+				if (out_of_core && tile.id % phases.tiles_y == color % 2) {
+					// Primer tile de la fila en esta fase: la siguiente fila de la misma paridad se lee mientras tanto.
+					ecosystem.prefetch_tile_row(tile.id / phases.tiles_y + 2);
+				}
+				if (torus) {
+					update_tile<Torus_Neighbors>(ecosystem, tile, tick, rules, delta);
+				}
+				else {
+					update_tile<Neighbors>(ecosystem, tile, tick, rules, delta);
+				}
+			});
+			if constexpr (striped) {
+				if (ecosystem.halo) {
+					#pragma omp single
+					if (!ecosystem.halo->after_phase(grid, color)) {
+						cerr << "Lost the connection with a neighboring stripe" << endl;
+						ecosystem.halo_lost = true;
+					}
+					if (ecosystem.halo_lost) {
+						return;  // Todos los hilos lo ven después de la barrera del single y salen juntos.
+					}
+				}
+			}
+		}
+		#pragma omp single
+		{
+			ecosystem.swap_grid();
+			ecosystem.stats.publish(tick + 1);
+			ecosystem.tick = tick + 1;
+		}
+		activity.rescan(grid, phases, tick + 1);
+		#pragma omp for
+		for (int i = 0; i < grid.rows; ++i) {
+			if (i < phases.x_begin || i >= phases.x_end) {
+				planes.build_span(grid, i, 0, grid.cols);  // Fila de halo.
+				continue;
+			}
+			const int tx = phases.tile_row(i);
+			for (int ty = 0; ty < phases.tiles_y; ++ty) {
+				const Tile& tile = phases.tiles[tx * phases.tiles_y + ty];
+				if (activity.is_active(tile.id)) {
+					planes.build_span(grid, i, tile.y0, tile.y1);
+				}
+			}
+		}
+		planes.wrap_edges();
+	}
+	else {
+		#pragma omp for
+		for (int i = 0; i < grid.rows; ++i) {
+			grid.sync_row(i);
+		}
+		#pragma omp for collapse(2)
+		for (int i = 0; i < grid.rows; ++i) {
+			for (int j = 0; j < grid.cols; ++j) {
+				const Random_Block random = cell_random(ecosystem.params.seed, Random_Stream::Tick, uint32_t(tick), grid.cell_id(i, j));
+				if (torus) {
+					update_cell<Torus_Neighbors>(grid, i, j, tick, random, planes.neighborhood(i, j), rules, delta);
+				}
+				else {
+					update_cell<Neighbors>(grid, i, j, tick, random, planes.neighborhood(i, j), rules, delta);
+				}
+			}
+		}
+		#pragma omp single
+		{
+			ecosystem.swap_grid();
+			ecosystem.stats.publish(tick + 1);
+			ecosystem.tick = tick + 1;
+		}
+		planes.build(grid);
+	}
+}
+
+/**
+ * @brief Ticks que advance_block puede avanzar de una vez desde un tick sin saltarse un cuadro ni un punto de control.
+ *
+ * Solo el último tick de un bloque puede dibujarse o guardarse, porque los anteriores nunca quedan completos en la cuadrícula.
+ * @param params Parámetros de la corrida.
+ * @param tick Primer tick del bloque.
+ * @return Entre 1 y params.temporal_block.
+ */
+inline int block_ticks(const Parameters& params, const int& tick) {
+	int count = min(params.temporal_block, params.ticks - tick);
+	count = min(count, (params.tick_update - tick % params.tick_update) % params.tick_update + 1);
+	if (!params.checkpoint.empty() && params.checkpoint_every > 0) {
+		count = min(count, (params.checkpoint_every - (tick + 1) % params.checkpoint_every) % params.checkpoint_every + 1);
+	}
+	return max(count, 1);
+}
+
+/**
+ * @brief Avanza count ticks en una sola pasada por las filas de tiles. Debe llamarse desde todos los hilos de una región omp parallel.
+ *
+ * Los ticks recorren la cuadrícula en un frente de onda (ver Wavefront), cada uno unas filas de tiles
+ * detrás del anterior y sobre los mismos dos búferes (ver Grid_View), con planos de bits alternos: cada
+ * fila se copia, se resume y se procesa para los count ticks mientras sigue en caché, en lugar de
+ * recorrer la cuadrícula entera una vez por tick. Cada tick aplica las mismas reglas, en el mismo
+ * orden dentro de cada tile y con los mismos sorteos por tick y célula que advance(), así que el
+ * resultado es idéntico. Los pasos de una ronda del frente no se tocan, así que sus filas a preparar
+ * van en un solo omp for (que se omite si no hay ninguna) y sus tiles en otros dos, uno por paridad de
+ * columna: con count ticks hay hasta count filas de tiles repartiéndose entre los hilos a la vez. Los
+ * tiles se procesan todos, sin el resumen de tiles activos. Necesita Schedule::Tiles, bordes cerrados
+ * y un solo proceso; con ecosystem.retire, count debe ser 1.
+ * Al terminar, ecosystem.planes describe el nuevo búfer actual y ecosystem.stats tiene los registros de los count ticks.
+ * @param ecosystem Ecosistema a avanzar.
+ * @param tick Primer tick a calcular.
+ * @param count Ticks a calcular (a lo sumo params.temporal_block).
+ * @param rules Reglas de las que salen las constantes.
+ * @param observe Recibe el registro de cada tick, en orden, desde un solo hilo.
+ */
+template<typename Neighbors = Moore_Neighbors, typename Layout, typename Rules, typename Observer>
+void advance_block(Basic_Ecosystem<Layout>& ecosystem, const int& tick, const int& count, const Rules& rules, Observer&& observe) {
+	Basic_Grid<Layout>& grid = ecosystem.grid;
+	const Tile_Phases& phases = ecosystem.phases;
+	const Wavefront wavefront(phases, count + 1);  // El último carril solo resume en planos de bits el estado final.
+	const auto rows_of = [&](const int& tile_row) { return min(phases.x_begin + tile_row * phases.tile_size, phases.x_end); };
+	for (size_t round = 0; round + 1 < wavefront.rounds.size(); ++round) {
+		const Wavefront_Step* first = wavefront.steps.data() + wavefront.rounds[round];
+		const Wavefront_Step* last = wavefront.steps.data() + wavefront.rounds[round + 1];
+		int prepared = 0;  // Filas a preparar en la ronda, de todos los pasos.
+		int working = 0;   // Pasos de la ronda que procesan tiles (el carril count solo prepara).
+		for (const Wavefront_Step* step = first; step != last; ++step) {
+			prepared += rows_of(step->prepare_end) - rows_of(step->prepare_begin);
+			working += step->lane < count;
+		}
+		if (prepared > 0) {
+			#pragma omp for
+			for (int n = 0; n < prepared; ++n) {
+				const Wavefront_Step* step = first;
+				int i = n;
+				for (; i >= rows_of(step->prepare_end) - rows_of(step->prepare_begin); ++step) {
+					i -= rows_of(step->prepare_end) - rows_of(step->prepare_begin);
+				}
+				i += rows_of(step->prepare_begin);
+				Grid_View<Layout> view(grid, step->lane);
+				if (step->lane < count) {
+					view.sync_row(i);
+				}
+				if (step->lane > 0) {
+					Bitplanes& planes = step->lane % 2 == 0 ? ecosystem.planes : *ecosystem.spare_planes;
+					planes.build_span(view, i, 0, grid.cols);  // Los planos del primer tick ya describen grid.current().
+				}
+			}
+		}
+		if (working == 0) {
+			continue;
+		}
+		for (int parity = 0; parity < 2; ++parity) {
+			const int per_step = (phases.tiles_y - parity + 1) / 2;  // Tiles de la fila con esta paridad.
+			#pragma omp for schedule(dynamic)
+			for (int n = 0; n < working * per_step; ++n) {
+				const Wavefront_Step& step = *(first + n / per_step);  // Los pasos del carril count van al final de la ronda.
+				const Tile& tile = phases.tiles[size_t(step.tile_row) * phases.tiles_y + parity + 2 * (n % per_step)];
+				Grid_View<Layout> view(grid, step.lane);
+				Bitplanes& planes = step.lane % 2 == 0 ? ecosystem.planes : *ecosystem.spare_planes;
+				update_tile<Neighbors>(view, planes, ecosystem.params.seed, tile, tick + step.lane, rules, ecosystem.stats.local(step.lane));
+			}
+		}
+	}
+	#pragma omp single
+	{
+		for (int lane = 0; lane < count; ++lane) {
+			ecosystem.stats.publish(tick + lane + 1, lane);
+			observe(ecosystem.stats.latest());
+		}
+		if (count % 2 != 0) {
+			ecosystem.swap_grid();
+			swap(ecosystem.planes, *ecosystem.spare_planes);
+		}
+		ecosystem.tick = tick + count;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * @file Species.hpp
+ * @brief Especies de la simulación, sin dependencias para las herramientas que solo leen sus registros.
+ */
+
+#include <cstdint>
+
+using namespace std;
+
+/**
+ * @enum Species
+ * @brief Define las especies posibles en la simulación.
+ */
+enum struct Species : uint8_t { Empty, Plant, Herbivore, Carnivore };
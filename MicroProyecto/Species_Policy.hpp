@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+ * @file Species_Policy.hpp
+ * @brief Reglas de cada especie de animal como clases de política resueltas al compilar.
+ *
+ * update_animal() es un solo kernel instanciado con la política de cada especie: las constantes quedan
+ * fijas en el código generado y agregar un animal es agregar una especialización de Species_Policy.
+ */
+
+#include <cstdint>
+
+#include "Bitplanes.hpp"
+#include "Grid.hpp"
+#include "Parameters.hpp"
+
+using namespace std;
+
+/**
+ * @struct Animal_Constants
+ * @brief Constantes de una especie de animal, tomadas de Species_Parameters.
+ */
+struct Animal_Constants {
+	int max_age;                   /**< Edad máxima antes de morir. */
+	int energy;                    /**< Energía inicial. */
+	int satiation;                 /**< Hambre inicial y después de comer. */
+	int energy_gain;               /**< Energía ganada al comer. */
+	int reproduction_energy;       /**< Energía requerida para reproducirse. */
+	int reproduction_energy_loss;  /**< Energía perdida al reproducirse. */
+};
+
+/**
+ * @struct Species_Policy
+ * @brief Política de una especie de animal; solo existen las especializaciones.
+ *
+ * Cada especialización define:
+ * - prey: especie que come.
+ * - absorbs_prey: al comer suma además la energía de la presa.
+ * - prey_mask(hood): vecinos con su presa en el búfer actual.
+ * - constants(species): sus Animal_Constants.
+ * @tparam S Especie del animal.
+ */
+template<Species S>
+struct Species_Policy;
+
+/** Los herbívoros comen plantas. */
+template<>
+struct Species_Policy<Species::Herbivore> {
+	static constexpr Species prey = Species::Plant;
+	static constexpr bool absorbs_prey = false;
+
+	static uint8_t prey_mask(const Neighborhood& hood) { return hood.plant; }
+
+	static constexpr Animal_Constants constants(const Species_Parameters& species) {
+		return { species.max_herbivore_age, species.herbivore_energy, species.herbivore_satiation,
+			species.herbivore_energy_gain, species.herbivore_reproduction_energy, species.herbivore_reproduction_energy_loss };
+	}
+};
+
+/** Los carnívoros comen herbívoros y se quedan también con su energía. */
+template<>
+struct Species_Policy<Species::Carnivore> {
+	static constexpr Species prey = Species::Herbivore;
+	static constexpr bool absorbs_prey = true;
+
+	static uint8_t prey_mask(const Neighborhood& hood) { return hood.herbivore; }
+
+	static constexpr Animal_Constants constants(const Species_Parameters& species) {
+		return { species.max_carnivore_age, species.carnivore_energy, species.carnivore_satiation,
+			species.carnivore_energy_gain, species.carnivore_reproduction_energy, species.carnivore_reproduction_energy_loss };
+	}
+};
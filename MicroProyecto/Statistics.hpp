@@ -0,0 +1,206 @@
+#pragma once
+
+/**
+ * @file Statistics.hpp
+ * @brief Conteo incremental de la población: deltas por hilo dentro del tick y un registro por tick.
+ */
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <vector>
+#include <omp.h>
+
+#include "Grid.hpp"
+#include "Tick_Record.hpp"
+
+using namespace std;
+
+/**
+ * @struct Population_Delta
+ * @brief Cambios de un hilo durante un tick, por especie (indexados por Species).
+ */
+struct Population_Delta {
+	array<int64_t, 4> net;     /**< Células ganadas menos células perdidas. */
+	array<int64_t, 4> births;  /**< Células nacidas (aparición espontánea o reproducción). */
+	array<int64_t, 4> moves;   /**< Animales que se movieron (con o sin comer). */
+	array<int64_t, 4> eaten;   /**< Presas comidas, por especie de la presa. */
+};
+
+/**
+ * @brief Escribe una célula en el búfer siguiente y anota el cambio de especie.
+ * @param next Búfer siguiente.
+ * @param n Índice de la célula.
+ * @param cell Célula a escribir.
+ * @param delta Cambios del hilo que escribe.
+ */
+inline void place(Grid_Buffer& next, const size_t& n, const Cell& cell, Population_Delta& delta) {
+	delta.net[int(next[n].species())]--;
+	delta.net[int(cell.species())]++;
+	next[n] = cell;
+}
+
+/**
+ * @struct Population_Stats
+ * @brief Población por especie mantenida con los deltas de cada hilo, en O(hilos) por tick.
+ *
+ * Cada hilo acumula en su propio Population_Delta sin sincronización; al final del tick un solo hilo
+ * los reduce y publica un Tick_Record. Con varios carriles, cada hilo tiene un delta por carril, para
+ * los ticks que avanzan a la vez (ver advance_block), y cada carril se publica por separado. Los
+ * registros van a un anillo: latest() se puede llamar desde cualquier hilo mientras la simulación
+ * corre, sin detenerla. Con Schedule::Tiles los conteos son exactos; con Schedule::Rows las escrituras
+ * a vecinos compiten entre hilos y pueden desviarse.
+ */
+struct Population_Stats {
+	static constexpr int capacity = 64;  /**< Registros guardados en el anillo. */
+
+	array<int64_t, 4> population;  /**< Células de cada especie al final del último tick publicado. */
+
+	/**
+	 * @brief Reserva un delta por hilo y carril.
+	 * @param threads Hilos de la región paralela.
+	 * @param lanes Ticks que pueden estar en curso a la vez.
+	 */
+	explicit Population_Stats(const int& threads, const int& lanes = 1): population{}, lanes(lanes), slots(size_t(threads) * lanes), ring{}, published(0) {}
+
+	/**
+	 * @brief Cuenta la población de la cuadrícula (una sola vez, O(células), con un hilo por delta) y publica el registro inicial. Llamar fuera de una región paralela.
+	 * @param grid Cuadrícula.
+	 * @param tick Ticks completados.
+	 * @param x_begin Primera fila contada.
+	 * @param x_end Fila siguiente a la última contada (se limita a grid.rows).
+	 */
+	template<typename Grid_Type>
+	void start(const Grid_Type& grid, const int& tick = 0, const int& x_begin = 0, const int& x_end = INT_MAX) {
+		const Grid_Buffer& cells = grid.current();
+		int64_t counts[4] = {};
+		#pragma omp parallel for schedule(static) num_threads(int(slots.size()) / lanes) reduction(+ : counts[:4])
+		for (int x = x_begin; x < min(x_end, grid.rows); ++x) {
+			grid.for_each_run(x, 0, grid.cols, [&](const size_t& first, const int&, const int& count) {
+				for (size_t n = first; n < first + count; ++n) {
+					counts[int(cells[n].species())]++;
+				}
+			});
+		}
+		for (int s = 0; s < 4; ++s) {
+			population[s] = counts[s];
+		}
+		for (Thread_Delta& slot : slots) {
+			slot.delta = {};
+		}
+		Tick_Record record = { tick, population, {}, {}, {}, {} };
+		push(record);
+	}
+
+	/**
+	 * @param lane Carril del tick que se está calculando.
+	 * @return Delta del hilo que llama en ese carril.
+	 */
+	Population_Delta& local(const int& lane = 0) { return slots[size_t(omp_get_thread_num()) * lanes + lane].delta; }
+
+	/**
+	 * @brief Reduce los deltas de todos los hilos en un carril y publica el registro del tick. Llamar desde un solo hilo, después de una barrera.
+	 * @param tick Ticks completados.
+	 * @param lane Carril del tick.
+	 */
+	void publish(const int& tick, const int& lane = 0) {
+		Tick_Record record = { tick, {}, {}, {}, {}, {} };
+		for (size_t n = size_t(lane); n < slots.size(); n += lanes) {
+			Thread_Delta& slot = slots[n];
+			for (int s = 0; s < 4; ++s) {
+				population[s] += slot.delta.net[s];
+				record.births[s] += slot.delta.births[s];
+				record.moves[s] += slot.delta.moves[s];
+				record.eaten[s] += slot.delta.eaten[s];
+				record.deaths[s] += slot.delta.births[s] - slot.delta.net[s];
+			}
+			slot.delta = {};
+		}
+		record.population = population;
+		record.deaths[int(Species::Empty)] = 0;
+		push(record);
+	}
+
+	/**
+	 * @return El último registro publicado. Se puede llamar desde cualquier hilo.
+	 *
+	 * Es la lectura de un seqlock: published hace de número de secuencia. Si mientras se copiaba el
+	 * registro push() pudo haber empezado a sobrescribir su casilla, la copia se descarta y se repite.
+	 */
+	Tick_Record latest() const {
+		for (;;) {
+			const uint64_t count = published.load(memory_order_acquire);
+			const Tick_Record record = ring[(count - 1) % capacity].load();
+			atomic_thread_fence(memory_order_acquire);
+			if (published.load(memory_order_relaxed) - count < capacity - 1) {
+				return record;
+			}
+		}
+	}
+
+private:
+	/**
+	 * @struct Thread_Delta
+	 * @brief Delta de un hilo en su propia línea de caché.
+	 */
+	struct alignas(64) Thread_Delta {
+		Population_Delta delta;  /**< Cambios del hilo. */
+	};
+
+	/**
+	 * @struct Record_Slot
+	 * @brief Casilla del anillo: un Tick_Record guardado campo por campo en atómicos, para que latest() la lea mientras push() escribe.
+	 */
+	struct Record_Slot {
+		static constexpr int fields = 1 + 5 * 4;  /**< tick y los cinco arreglos por especie. */
+
+		atomic<int64_t> values[fields];  /**< Campos del registro, en el orden de columns. */
+
+		/** @brief Escribe un registro (relaxed; el orden lo dan las barreras de push()). */
+		void store(const Tick_Record& record) {
+			values[0].store(record.tick, memory_order_relaxed);
+			for (int c = 0; c < 5; ++c) {
+				for (int s = 0; s < 4; ++s) {
+					values[1 + c * 4 + s].store((record.*columns[c])[s], memory_order_relaxed);
+				}
+			}
+		}
+
+		/** @return El registro guardado (relaxed; el orden lo dan las barreras de latest()). */
+		Tick_Record load() const {
+			Tick_Record record;
+			record.tick = int(values[0].load(memory_order_relaxed));
+			for (int c = 0; c < 5; ++c) {
+				for (int s = 0; s < 4; ++s) {
+					(record.*columns[c])[s] = values[1 + c * 4 + s].load(memory_order_relaxed);
+				}
+			}
+			return record;
+		}
+
+	private:
+		static constexpr array<int64_t, 4> Tick_Record::* columns[5] = {
+			&Tick_Record::population, &Tick_Record::births, &Tick_Record::deaths, &Tick_Record::moves, &Tick_Record::eaten
+		};
+	};
+
+	int lanes;                      /**< Ticks que pueden estar en curso a la vez: deltas de cada hilo. */
+	vector<Thread_Delta> slots;     /**< lanes deltas por hilo, desde omp_get_thread_num() * lanes. */
+	Record_Slot ring[capacity];     /**< Últimos registros publicados. */
+	atomic<uint64_t> published;     /**< Registros publicados desde el inicio. */
+
+	/**
+	 * @brief Guarda un registro en el anillo y lo hace visible a latest(). Solo desde un hilo a la vez.
+	 *
+	 * La barrera release antes de escribir la casilla asegura que un lector que vea alguno de los
+	 * campos nuevos vea también el published de este push, y descarte su copia.
+	 */
+	void push(const Tick_Record& record) {
+		const uint64_t count = published.load(memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		ring[count % capacity].store(record);
+		published.store(count + 1, memory_order_release);
+	}
+};
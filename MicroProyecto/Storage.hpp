@@ -0,0 +1,237 @@
+#pragma once
+
+/**
+ * @file Storage.hpp
+ * @brief Arreglos que viven en el heap o en un archivo mapeado a memoria, para cuadrículas más grandes que la RAM.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * @struct Paged_Array
+ * @brief Arreglo de tamaño fijo, en el heap o en un archivo temporal mapeado con MAP_SHARED.
+ *
+ * Con un directorio, los datos viven en un archivo que se borra apenas se mapea (desaparece al terminar
+ * el proceso) y el sistema operativo decide qué páginas quedan en RAM: las que no se usaron hace tiempo
+ * se escriben al disco y se liberan, así que el conjunto residente queda acotado por la memoria libre
+ * y no por el tamaño del arreglo. prefetch() pide las páginas de un tramo antes de usarlas.
+ *
+ * La memoria se reserva sin tocarla y el valor inicial se escribe en paralelo con omp for estático: en
+ * una máquina NUMA cada página queda en el nodo del hilo que la escribe primero, que con el reparto
+ * estático por filas es el que después la actualiza. allocate() reserva sin escribir nada, para quien
+ * llena el arreglo en su propio orden (ver Basic_Grid).
+ * @tparam T Tipo de los elementos (trivialmente copiable).
+ */
+template<typename T>
+struct Paged_Array {
+	Paged_Array() = default;
+
+	/**
+	 * @brief Reserva count elementos con un valor inicial.
+	 * @param count Número de elementos.
+	 * @param value Valor inicial.
+	 * @param directory Directorio del archivo mapeado; vacío = en el heap.
+	 * @param threads Hilos que escriben el valor inicial.
+	 */
+	Paged_Array(const size_t& count, const T& value, const string& directory = "", const int& threads = 1) {
+		assign(count, value, directory, threads);
+	}
+
+	~Paged_Array() { unmap(); }
+
+	Paged_Array(const Paged_Array&) = delete;
+	Paged_Array& operator=(const Paged_Array&) = delete;
+
+	Paged_Array(Paged_Array&& other) noexcept { *this = move(other); }
+	Paged_Array& operator=(Paged_Array&& other) noexcept {
+		if (this != &other) {
+			unmap();
+			pointer = other.pointer;
+			count = other.count;
+			mapped = other.mapped;
+			other.pointer = nullptr;
+			other.count = 0;
+			other.mapped = false;
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Reemplaza el contenido por count copias de un valor.
+	 * @param count Número de elementos.
+	 * @param value Valor inicial.
+	 * @param directory Directorio del archivo mapeado; vacío = en el heap.
+	 * @param threads Hilos que escriben el valor inicial (ver la descripción de la estructura).
+	 */
+	void assign(const size_t& count, const T& value, const string& directory = "", const int& threads = 1) {
+		allocate(count, directory);
+		T* const first = pointer;
+		#pragma omp parallel for schedule(static) num_threads(threads)
+		for (ptrdiff_t n = 0; n < ptrdiff_t(count); ++n) {
+			first[n] = value;
+		}
+	}
+
+	/**
+	 * @brief Reserva count elementos sin escribirlos: en el heap su valor queda indefinido, en un archivo mapeado son ceros.
+	 * @param count Número de elementos.
+	 * @param directory Directorio del archivo mapeado; vacío = en el heap.
+	 */
+	void allocate(const size_t& count, const string& directory = "") {
+		unmap();
+		this->count = count;
+		const size_t bytes = max(count, size_t(1)) * sizeof(T);
+#ifndef _WIN32
+		if (!directory.empty()) {
+			map_file(directory, bytes);
+		}
+#else
+		(void)directory;
+#endif
+		if (!mapped) {
+			pointer = static_cast<T*>(::operator new(bytes));
+		}
+	}
+
+	/**
+	 * @brief Reemplaza el contenido por count elementos de un archivo existente, proyectados con MAP_PRIVATE.
+	 *
+	 * No se copia nada: cada página se lee del archivo la primera vez que se toca, y las escrituras
+	 * quedan en memoria (copia al escribir) sin modificar el archivo. Dos arreglos proyectados del
+	 * mismo tramo son independientes.
+	 * @param path Archivo.
+	 * @param offset Posición del primer elemento en el archivo (múltiplo del tamaño de página).
+	 * @param count Número de elementos.
+	 * @return false si no hay mmap, offset no está alineado a página o la proyección falla; el arreglo queda vacío.
+	 */
+	bool map_copy(const string& path, const uint64_t& offset, const size_t& count) {
+		unmap();
+		this->count = 0;
+#ifndef _WIN32
+		const uint64_t page = uint64_t(sysconf(_SC_PAGESIZE));
+		const int fd = offset % page == 0 ? ::open(path.c_str(), O_RDONLY) : -1;
+		if (fd < 0) {
+			return false;
+		}
+		void* address = mmap(nullptr, max(count, size_t(1)) * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, off_t(offset));
+		close(fd);
+		if (address == MAP_FAILED) {
+			return false;
+		}
+		pointer = static_cast<T*>(address);
+		this->count = count;
+		mapped = true;
+		return true;
+#else
+		(void)path;
+		(void)offset;
+		(void)count;
+		return false;
+#endif
+	}
+
+	/** @return Primer elemento. */
+	T* data() { return pointer; }
+	/** @return Primer elemento. */
+	const T* data() const { return pointer; }
+	/** @return Número de elementos. */
+	size_t size() const { return count; }
+	/** @return Primer elemento. */
+	T* begin() { return pointer; }
+	/** @return Primer elemento. */
+	const T* begin() const { return pointer; }
+	/** @return Posición siguiente al último elemento. */
+	T* end() { return pointer + count; }
+	/** @return Posición siguiente al último elemento. */
+	const T* end() const { return pointer + count; }
+	T& operator[](const size_t& n) { return pointer[n]; }
+	const T& operator[](const size_t& n) const { return pointer[n]; }
+
+	/** @return Los datos viven en un archivo mapeado (temporal, o de solo lectura con map_copy()). */
+	bool is_mapped() const { return mapped; }
+
+	/**
+	 * @brief Pide al sistema que lea del disco un tramo de elementos sin esperar (no hace nada en el heap).
+	 * @param first Primer elemento del tramo.
+	 * @param length Elementos del tramo.
+	 */
+	void prefetch(const size_t& first, const size_t& length) const {
+#ifndef _WIN32
+		if (!mapped || first >= count) {
+			return;
+		}
+		static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+		const uintptr_t begin = uintptr_t(pointer + first) / page * page;
+		const uintptr_t end = uintptr_t(pointer + min(first + length, count));
+		madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#else
+		(void)first;
+		(void)length;
+#endif
+	}
+
+private:
+	T* pointer = nullptr;   /**< Primer elemento (en heap o en el mapeo). */
+	size_t count = 0;       /**< Número de elementos. */
+	bool mapped = false;    /**< pointer apunta a un mapeo de archivo. */
+
+#ifndef _WIN32
+	/**
+	 * @brief Mapea un archivo temporal (ya borrado) de bytes bytes en directory; termina el programa si falla.
+	 *
+	 * El espacio en disco se reserva entero antes de mapear: sin eso el archivo sería disperso y un
+	 * disco lleno aparecería como SIGBUS en medio de la corrida, al escribir una página nueva.
+	 */
+	void map_file(const string& directory, const size_t& bytes) {
+		string path = directory + "/ecosystem-XXXXXX";
+		const int fd = mkstemp(path.data());
+		if (fd < 0) {
+			perror(("mkstemp " + directory).c_str());
+			exit(1);
+		}
+		unlink(path.c_str());
+		const int error = posix_fallocate(fd, 0, off_t(bytes));
+		if (error != 0) {
+			errno = error;
+			perror(("posix_fallocate " + directory).c_str());
+			exit(1);
+		}
+		void* address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (address == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+		pointer = static_cast<T*>(address);
+		mapped = true;
+	}
+#endif
+
+	/** @brief Libera la memoria o el mapeo. */
+	void unmap() {
+#ifndef _WIN32
+		if (mapped) {
+			munmap(pointer, max(count, size_t(1)) * sizeof(T));
+		}
+#endif
+		if (!mapped) {
+			::operator delete(pointer);
+		}
+		mapped = false;
+		pointer = nullptr;
+	}
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+/**
+ * @file Tick_Record.hpp
+ * @brief Registro de la población de un tick: lo que guarda la serie de tiempo y lo que leen sus herramientas.
+ */
+
+#include <array>
+#include <cstdint>
+
+#include "Species.hpp"
+
+using namespace std;
+
+/**
+ * @struct Tick_Record
+ * @brief Estadísticas de la población al terminar un tick.
+ */
+struct Tick_Record {
+	int tick;                       /**< Ticks completados (0 = estado inicial). */
+	array<int64_t, 4> population;   /**< Células de cada especie. */
+	array<int64_t, 4> births;       /**< Nacimientos en el tick. */
+	array<int64_t, 4> deaths;       /**< Células que desaparecieron en el tick sin moverse (por edad, hambre, energía o al ser comidas o pisadas). */
+	array<int64_t, 4> moves;        /**< Movimientos en el tick. */
+	array<int64_t, 4> eaten;        /**< Presas comidas en el tick, por especie de la presa. */
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * @file Tiles.hpp
+ * @brief División de la cuadrícula en bloques (tiles) agrupados en fases de color.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct Tile
+ * @brief Rectángulo de células [x0, x1) x [y0, y1) que un hilo procesa en orden fila por fila.
+ */
+struct Tile {
+	int x0;  /**< Primera fila. */
+	int y0;  /**< Primera columna. */
+	int x1;  /**< Fila siguiente a la última. */
+	int y1;  /**< Columna siguiente a la última. */
+	int id;  /**< Posición del tile en Tile_Phases::tiles (tx * tiles_y + ty). */
+};
+
+/**
+ * @struct Tile_Phases
+ * @brief Tiles de la cuadrícula repartidos en cuatro colores según la paridad de su posición.
+ *
+ * update_cell solo lee y escribe next() a distancia 1 de la célula, así que con tiles de al menos
+ * 2x2 dos tiles del mismo color nunca tocan la misma célula. Los tiles de una fase pueden correr en
+ * paralelo en cualquier orden y el resultado no depende del número de hilos.
+ */
+struct Tile_Phases {
+	static constexpr int colors = 4;  /**< Número de fases por tick. */
+
+	int tile_size;                 /**< Lado de cada tile en células. */
+	int x_begin;                   /**< Primera fila cubierta por los tiles. */
+	int x_end;                     /**< Fila siguiente a la última cubierta por los tiles. */
+	int first_tile_row;            /**< Fila de tiles de la cuadrícula completa donde empiezan estos tiles (decide el color). */
+	int tiles_x;                   /**< Número de tiles por columna. */
+	int tiles_y;                   /**< Número de tiles por fila. */
+	vector<Tile> tiles;            /**< Todos los tiles, indexados por Tile::id. */
+	vector<Tile> phases[colors];   /**< Tiles de cada fase, en orden fila por fila. */
+
+	/**
+	 * @brief Divide las filas [x_begin, x_end) de una cuadrícula en tiles y los asigna a su fase.
+	 *
+	 * Si la cuadrícula es una franja de otra más grande, x_begin + row_offset debe caer en un borde de tile.
+	 * @param rows Número de filas de la cuadrícula.
+	 * @param cols Número de columnas de la cuadrícula.
+	 * @param tile_size Lado de cada tile (mínimo 2).
+	 * @param x_begin Primera fila cubierta.
+	 * @param x_end Fila siguiente a la última cubierta (se limita a rows).
+	 * @param row_offset Fila de la cuadrícula completa que corresponde a la fila 0 (ver Grid::row_offset).
+	 */
+	Tile_Phases(const int& rows, const int& cols, const int& tile_size, const int& x_begin = 0, const int& x_end = INT_MAX, const int& row_offset = 0):
+		tile_size(max(tile_size, 2)), x_begin(x_begin), x_end(min(x_end, rows))
+	{
+		first_tile_row = (row_offset + x_begin) / this->tile_size;
+		tiles_x = (this->x_end - x_begin + this->tile_size - 1) / this->tile_size;
+		tiles_y = (cols + this->tile_size - 1) / this->tile_size;
+		for (int tx = 0; tx < tiles_x; ++tx) {
+			for (int ty = 0; ty < tiles_y; ++ty) {
+				const int x = x_begin + tx * this->tile_size;
+				const int y = ty * this->tile_size;
+				const Tile tile = { x, y, min(x + this->tile_size, this->x_end), min(y + this->tile_size, cols), tx * tiles_y + ty };
+				tiles.push_back(tile);
+				phases[color(tx, ty)].push_back(tile);
+			}
+		}
+	}
+
+	/** @return Fase de la fila de tiles tx (local) y la columna de tiles ty. */
+	int color(const int& tx, const int& ty) const { return ((first_tile_row + tx) % 2) * 2 + (ty % 2); }
+
+	/** @return Fila de tiles (local) que contiene la fila x. */
+	int tile_row(const int& x) const { return (x - x_begin) / tile_size; }
+};
+
+/**
+ * @struct Wavefront_Step
+ * @brief Un paso de un frente de onda: un tick procesa una fila de tiles, después de preparar las filas que le faltan.
+ */
+struct Wavefront_Step {
+	int lane;           /**< Tick del bloque (0 = el primero). */
+	int tile_row;       /**< Fila de tiles a procesar. */
+	int prepare_begin;  /**< Primera fila de tiles a preparar (copiar al búfer siguiente y resumir en planos de bits). */
+	int prepare_end;    /**< Fila de tiles siguiente a la última a preparar. */
+};
+
+/**
+ * @struct Wavefront
+ * @brief Orden en que varios ticks seguidos recorren las filas de tiles, cada uno unas filas detrás del anterior.
+ *
+ * Dentro de un tick, cada fila de tiles de colores 0 y 1 va antes que sus vecinas de colores 2 y 3,
+ * igual que en las fases; el orden entre tiles que no se tocan no cambia el resultado. Un tick procesa
+ * la fila R cuando el anterior terminó todas las filas hasta R + 2: así las células que lee (de la fila
+ * R - 1 a la R + 1) ya tienen su valor final y las que escribe el anterior ya no las necesita. Cada
+ * tick avanza una fila por ronda, de modo que todos trabajan a pocas filas de distancia y lo que uno
+ * escribe sigue en caché cuando el siguiente lo lee. La condición se evalúa con lo terminado antes de
+ * la ronda, así que los pasos de una ronda están al menos tres filas de tiles separados, no comparten
+ * células ni planos de bits y pueden procesarse a la vez.
+ */
+struct Wavefront {
+	vector<Wavefront_Step> steps;  /**< Pasos en orden, agrupados por ronda. */
+	vector<int> rounds;            /**< Primer paso de cada ronda, más steps.size() al final. */
+
+	/**
+	 * @param phases Tiles de la cuadrícula.
+	 * @param lanes Ticks del bloque.
+	 */
+	Wavefront(const Tile_Phases& phases, const int& lanes) {
+		const int rows = phases.tiles_x;
+		const auto early = [&](const int& tx) { return phases.color(tx, 0) < 2; };
+		vector<int> order;
+		for (int tx = 0; tx < rows; ++tx) {
+			if (early(tx)) {
+				order.push_back(tx);
+				if (tx > 0) {
+					order.push_back(tx - 1);
+				}
+			}
+		}
+		if (rows > 0 && !early(rows - 1)) {
+			order.push_back(rows - 1);
+		}
+		vector<int> position(lanes, 0);  // Siguiente fila de order de cada tick.
+		vector<int> finished(lanes, 0);  // Filas [0, finished) terminadas por cada tick.
+		vector<int> prepared(lanes, 0);  // Filas [0, prepared) preparadas por cada tick.
+		vector<vector<bool>> done(lanes, vector<bool>(rows, false));
+		vector<int> before(lanes, 0);    // finished al empezar la ronda.
+		for (size_t remaining = size_t(lanes) * rows; remaining > 0;) {
+			rounds.push_back(int(steps.size()));
+			before = finished;
+			for (int lane = 0; lane < lanes; ++lane) {
+				if (position[lane] == rows) continue;
+				const int row = order[position[lane]];
+				if (lane > 0 && before[lane - 1] < min(row + 3, rows)) continue;
+				const int end = max(prepared[lane], min(row + 2, rows));
+				steps.push_back({ lane, row, prepared[lane], end });
+				prepared[lane] = end;
+				done[lane][row] = true;
+				while (finished[lane] < rows && done[lane][finished[lane]]) {
+					++finished[lane];
+				}
+				++position[lane];
+				--remaining;
+			}
+		}
+		rounds.push_back(int(steps.size()));
+	}
+};
@@ -0,0 +1,28 @@
+/**
+ * @file SeriesToCsv.cpp
+ * @brief Convierte un archivo de la serie de tiempo (--series) a CSV, con una fila por tick.
+ *
+ * Compilar desde MicroProyecto/:
+ *   g++ -std=c++20 -O2 Tools/SeriesToCsv.cpp -o series_to_csv
+ * Uso:
+ *   ./series_to_csv corrida.series > corrida.csv
+ */
+
+#include <iostream>
+
+#include "../Recorder.hpp"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc != 2) {
+		cerr << "Usage: " << argv[0] << " <series file>" << endl;
+		return 1;
+	}
+	Series_Table table;
+	if (!read_series(argv[1], table)) {
+		return 1;
+	}
+	write_series_csv(cout, table);
+	return 0;
+}
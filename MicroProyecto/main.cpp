@@ -5,391 +5,152 @@
 
 #include <iostream>
 #include <vector>
-#include <random>
 #include <omp.h>
 
-using namespace std;
-
-/** Tamaño de la cuadrícula. */
-const int grid_size = 60;
-/** Número de iteraciones de la simulación. */
-const int num_ticks = 1500;
-/** Intervalo para imprimir el estado de la cuadrícula. */
-const int tick_update = 250;
-/** Número de hilos a utilizar en la simulación. */
-const int num_threads = 12;
-
-#define plant_spawn_rate      0.5  /**< Porcentaje de aparición inicial de plantas. */
-#define carnivore_spawn_rate  0.1  /**< Porcentaje de aparición inicial de carnívoros. */
-#define herbivore_spawn_rate  0.1  /**< Porcentaje de aparición inicial de herbívoros. */
-
-#define plant_after_spawn_rate     0.05  /**< Porcentaje de aparición de plantas después del inicio. */
-#define carnivore_after_spawn_rate 0.025 /**< Porcentaje de aparición de carnívoros después del inicio. */
-#define herbivore_after_spawn_rate 0.025 /**< Porcentaje de aparición de herbívoros después del inicio. */
-
-#define plant_reproduction_chance 0.3  /**< Probabilidad de reproducción de las plantas. */
-#define max_plant_age 150 /**< Edad máxima de las plantas antes de morir. */
-
-#define carnivore_energy 20  /**< Energía inicial de los carnívoros. */
-#define herbivore_energy 15  /**< Energía inicial de los herbívoros. */
-
-#define carnivore_reproduction_energy 35  /**< Energía requerida para que un carnívoro se reproduzca. */
-#define herbivore_reproduction_energy 65  /**< Energía requerida para que un herbívoro se reproduzca. */
-
-#define carnivore_reproduction_energy_loss 25  /**< Pérdida de energía al reproducirse para los carnívoros. */
-#define herbivore_reproduction_energy_loss 45  /**< Pérdida de energía al reproducirse para los herbívoros. */
+#include "Benchmark.hpp"
+#include "Checkpoint.hpp"
+#include "Density.hpp"
+#include "Distributed.hpp"
+#include "Ensemble.hpp"
+#include "Recorder.hpp"
+#include "Renderer.hpp"
+#include "Simulation.hpp"
 
-#define carnivore_satiation 40  /**< Nivel de pancita llena inicial de los carnívoros. */
-#define herbivore_satiation 20  /**< Nivel de pancita llena inicial de los herbívoros. */
-
-#define carnivore_energy_gain 20 + grid[nx][ny].energy  /**< Energía ganada por un carnívoro al comer un herbívoro. */
-#define herbivore_energy_gain 10                        /**< Energía ganada por un herbívoro al comer una planta. */
-
-#define max_carnivore_age 70  /**< Edad máxima de los carnívoros antes de morir. */
-#define max_herbivore_age 80  /**< Edad máxima de los herbívoros antes de morir. */
-
-/**
- * @enum Species
- * @brief Define las especies posibles en la simulación.
- */
-enum struct Species { Empty, Plant, Herbivore, Carnivore };
-
-/**
- * @struct Cell
- * @brief Representa una célula en la cuadrícula, que puede contener una especie o estar vacía.
- */
-struct Cell {
-	Species species;  /**< Especie en la célula. */
-	int energy;       /**< Energía de la célula. */
-	int hunger;       /**< Nivel de hambre de la célula. */
-	int age;          /**< Edad de la célula. */
-
-	/**
-	 * @brief Constructor para inicializar una célula con una especie.
-	 * @param species Especie a la que pertenece la célula.
-	 */
-	Cell(const Species& species = Species::Empty): species(species) {
-		switch (species) {
-			case Species::Empty: {
-				energy = 0;
-				hunger = 0;
-				age = 0;
-				break;
-			}
-			case Species::Plant: {
-				energy = 0;
-				hunger = 0;
-				age = 0;
-				break;
-			}
-			case Species::Herbivore: {
-				energy = herbivore_energy;
-				hunger = herbivore_satiation;
-				age = 0;
-				break;
-			}
-			case Species::Carnivore: {
-				energy = carnivore_energy;
-				hunger = carnivore_satiation;
-				age = 0;
-				break;
-			}
-		}
-	}
-};
-using Grid = vector<vector<Cell>>;
-
-/**
- * @brief Inicializa la cuadrícula con especies distribuidas aleatoriamente.
- * @param grid Cuadrícula a inicializar.
- */
-void initialize_grid(Grid& grid) {
-	for (int i = 0; i < grid_size; ++i) {
-		for (int j = 0; j < grid_size; ++j) {
-			grid[i][j] = Cell(Species::Empty);
-			if (double(rand() % 100) < (plant_spawn_rate * 100.0)) {
-				grid[i][j] = Cell(Species::Plant);
-			}
-			if (double(rand()*j % 100) < (carnivore_spawn_rate * 100.0)) {
-				grid[i][j] = Cell(Species::Carnivore);
-			}
-			if (double(rand()*i % 100) < (herbivore_spawn_rate * 100.0)) {
-				grid[i][j] = Cell(Species::Herbivore);
-			}
-		}
-	}
-}
-
-/**
- * @brief Obtiene los vecinos de una posición en la cuadrícula.
- * @param x Coordenada x en la cuadrícula.
- * @param y Coordenada y en la cuadrícula.
- * @return Un vector de pares (x, y) que representan las posiciones vecinas.
- */
-vector<pair<int, int>> get_neighbors(int x, int y) {
-	vector<pair<int, int>> neighbors;
-	for (int dx = -1; dx <= 1; ++dx) {
-		for (int dy = -1; dy <= 1; ++dy) {
-			if (dx == 0 && dy == 0) continue;
-			int nx = x + dx;
-			int ny = y + dy;
-			if (nx >= 0 && nx < grid_size && ny >= 0 && ny < grid_size) {
-				neighbors.emplace_back(nx, ny);
-			}
-		}
-	}
-
-	return neighbors;
-}
-
-/**
- * @brief Mueve una célula a una posición vacía en la cuadrícula.
- * @param neighbors Vecinos de la célula.
- * @param next_grid Cuadrícula para la siguiente iteración.
- * @param cell Célula que se va a mover.
- */
-void move_to_empty(const vector<pair<int, int>>& neighbors, Grid& next_grid, Cell& cell) {
-	for (const auto& neighbor : neighbors) {
-		int nx = neighbor.first;
-		int ny = neighbor.second;
-		if (next_grid[nx][ny].species == Species::Empty) {
-			next_grid[nx][ny] = cell;
-			return;
-		}
-	}
-}
+using namespace std;
 
 /**
- * @brief Actualiza el estado de una célula en la cuadrícula.
- * @param current_cell Célula actual en la cuadrícula.
- * @param grid Cuadrícula actual.
- * @param next_grid Cuadrícula para la siguiente iteración.
- * @param x Coordenada x de la célula.
- * @param y Coordenada y de la célula.
- * @param random Número aleatorio utilizado para la actualización.
+ * @brief Simula la evolución del ecosistema a lo largo del tiempo.
+ * @param ecosystem Ecosistema ya inicializado (o restaurado de un punto de control).
+ * @param rules Reglas de las que salen las constantes.
+ * @param density Conteos por zona y mapa de densidad, si la corrida los pide.
+ * @param series Serie de tiempo, abierta si la corrida la pide.
  */
-void update_cell(const Cell& current_cell, const Grid& grid, Grid& next_grid, const int& x, const int& y, const int& random) {
-	if (current_cell.species == Species::Empty) {
-		if (random % 2 == 0) {
-			if (double(random % 100) < (plant_after_spawn_rate * 100.0)) {
-				next_grid[x][y] = Cell(Species::Plant);
-			}
-		}
-		else if (random % 2 == 1) {
-			if (double(random % 100) < (carnivore_after_spawn_rate * 100.0)) {
-				next_grid[x][y] = Cell(Species::Carnivore);
-			}
-		}
-		else if (random % 2 == 2) {
-			if (double(random % 100) < (herbivore_after_spawn_rate * 100.0)) {
-				next_grid[x][y] = Cell(Species::Herbivore);
-			}
-		}
+template<typename Layout, typename Rules>
+void simulate(Basic_Ecosystem<Layout>& ecosystem, const Rules& rules, Density_Report& density, Series_Recorder& series) {
+	const Parameters& params = ecosystem.params;
+	Frame_Renderer renderer(params.rows, params.cols, params.display);
+	Checkpoint_Writer checkpoints(ecosystem);
+	const bool checkpointing = !params.checkpoint.empty();
+	const int first_tick = ecosystem.tick;
+	const bool recording = series.is_open();
+	if (recording) {
+		series.push(ecosystem.stats.latest());
 	}
 
-	vector<pair<int, int>> neighbors = get_neighbors(x, y);
+	const bool measuring = density.enabled();
+	const bool blocked = params.temporal_block > 1;
 
-	for (int i = neighbors.size() - 1; i > 0; --i) {
-		int j = random % (i + 1);
-		swap(neighbors[i], neighbors[j]);
-	}
-
-	switch (current_cell.species) {
-		case Species::Plant: {
-			if (current_cell.age > max_plant_age) {
-				next_grid[x][y] = Cell(Species::Empty);
-				break;
-			}
-			else {
-				next_grid[x][y].age++;
-			}
-			for (auto& neighbor : neighbors) {
-				int nx = neighbor.first;
-				int ny = neighbor.second;
-				if (grid[nx][ny].species == Species::Empty && double(random % 100) < (plant_reproduction_chance * 100.0)) {
-					next_grid[nx][ny] = Cell(Species::Plant);
-					break;
-				}
-			}
-			break;
+	#pragma omp parallel num_threads(params.threads)
+	{
+		ecosystem.planes.build(ecosystem.grid);
+		if (measuring) {
+			density.tables.build(ecosystem.planes);
+			#pragma omp single
+			density.write(ecosystem.tick, true);
 		}
-		case Species::Herbivore: {
-			if (current_cell.energy <= 0 || current_cell.age > max_herbivore_age || current_cell.hunger <= 0) {
-				next_grid[x][y] = Cell(Species::Empty);
-				break;
-			}
-			else {
-				next_grid[x][y].age++;
-			}
-			bool ate = false;
-			for (auto& neighbor : neighbors) {
-				int nx = neighbor.first;
-				int ny = neighbor.second;
-				if (grid[nx][ny].species == Species::Plant) { // eat and move
-					next_grid[nx][ny] = current_cell;
-					next_grid[nx][ny].energy += herbivore_energy_gain;
-					next_grid[nx][ny].hunger = herbivore_satiation;
-					next_grid[x][y] = Cell(Species::Empty);
-					ate = true;
-					break;
-				}
-			}
-			if (!ate) {
-				next_grid[x][y].energy--;
-				next_grid[x][y].hunger--;
-				for (auto& neighbor : neighbors) {
-					int nx = neighbor.first;
-					int ny = neighbor.second;
-					if (grid[nx][ny].species == Species::Empty) { // move
-						next_grid[nx][ny] = current_cell;
-						next_grid[x][y] = Cell(Species::Empty);
-						break;
+		for (int tick = first_tick; tick < params.ticks; ++tick) {
+			if (blocked) {
+				// Varios ticks por pasada; tick queda en el último, el único que puede dibujarse o guardarse.
+				// Tras un punto de control se avanza un solo tick, cuyo intercambio entrega el búfer a escribir.
+				const int count = ecosystem.retire ? 1 : block_ticks(params, tick);
+				advance_block(ecosystem, tick, count, rules, [&](const Tick_Record& record) {
+					if (recording) {
+						series.push(record);
 					}
-				}
-			}
-			if (current_cell.energy >= herbivore_reproduction_energy) {
-				for (auto& neighbor : neighbors) {
-					int nx = neighbor.first;
-					int ny = neighbor.second;
-					if (next_grid[nx][ny].species == Species::Empty || next_grid[nx][ny].species == Species::Plant) {
-						next_grid[nx][ny] = Cell(Species::Herbivore);
-						next_grid[x][y].energy -= herbivore_reproduction_energy_loss;
-						break;
-					}
-				}
-			}
-			break;
-		}
-		case Species::Carnivore: {
-			if (current_cell.energy <= 0 || current_cell.age > max_carnivore_age || current_cell.hunger <= 0) {
-				next_grid[x][y] = Cell(Species::Empty);
-				break;
+				});
+				tick += count - 1;
 			}
 			else {
-				next_grid[x][y].age++;
-			}
-			bool ate = false;
-			for (auto& neighbor : neighbors) {
-				int nx = neighbor.first;
-				int ny = neighbor.second;
-				if (grid[nx][ny].species == Species::Herbivore) { // eat and move
-					next_grid[nx][ny] = current_cell;
-					next_grid[nx][ny].energy += carnivore_energy_gain;
-					next_grid[nx][ny].hunger = carnivore_satiation;
-					next_grid[x][y] = Cell(Species::Empty);
-					ate = true;
-					break;
+				advance(ecosystem, tick, rules);
+			}
+			if (measuring) {
+				// single, y no master: nadie debe reconstruir las tablas del tick siguiente mientras se consultan.
+				density.tables.build(ecosystem.planes);
+				#pragma omp single
+				density.write(ecosystem.tick, tick % params.tick_update == 0);
+			}
+			if (checkpointing) {
+				checkpoints.collect(ecosystem);
+				if (params.checkpoint_every > 0 && ecosystem.tick % params.checkpoint_every == 0) {
+					checkpoints.capture(ecosystem);
 				}
 			}
-			if (!ate) {
-				next_grid[x][y].energy--;
-				next_grid[x][y].hunger--;
-				for (auto& neighbor : neighbors) {
-					int nx = neighbor.first;
-					int ny = neighbor.second;
-					if (grid[nx][ny].species == Species::Empty) { // move
-						next_grid[nx][ny] = current_cell;
-						next_grid[x][y] = Cell(Species::Empty);
-						break;
-					}
+			#pragma omp master
+			{
+				if (recording && !blocked) {
+					series.push(ecosystem.stats.latest());
 				}
-			}
-
-			if (current_cell.energy >= carnivore_reproduction_energy) {
-				for (auto& neighbor : neighbors) {
-					int nx = neighbor.first;
-					int ny = neighbor.second;
-					if (next_grid[nx][ny].species == Species::Empty || next_grid[nx][ny].species == Species::Plant) {
-						next_grid[nx][ny] = Cell(Species::Carnivore);
-						next_grid[x][y].energy -= carnivore_reproduction_energy_loss;
-						break;
-					}
+				if (tick % params.tick_update == 0) {
+					renderer.render(ecosystem.grid, ecosystem.stats.latest());
 				}
 			}
-			break;
 		}
-		default: break;
+		if (checkpointing) {
+			checkpoints.capture(ecosystem, true);
+		}
+	}
+	checkpoints.wait();
+	if (checkpoints.skipped_count() > 0) {
+		cerr << "Skipped " << checkpoints.skipped_count() << " checkpoints while the previous one was still being written" << endl;
+	}
+	renderer.render(ecosystem.grid, ecosystem.stats.latest(), true);
+	if (params.load_report != 0) {
+		renderer.close();
+		ecosystem.scheduler.report(cerr);
 	}
 }
 
 /**
- * @brief Imprime el estado actual de la cuadrícula, incluyendo el conteo de especies.
- * @param grid Cuadrícula a imprimir.
+ * @brief Punto de entrada del programa. Lee los parámetros, inicializa y ejecuta la simulación (o un benchmark).
+ * @param argc Número de argumentos.
+ * @param argv Argumentos: "--nombre valor" o "--config archivo" (ver README).
+ * @return Código de salida del programa.
  */
-void print_grid(const Grid& grid) {
-	int plants = 0;
-	int herbivores = 0;
-	int carnivores = 0;
-	for (const auto& row : grid) {
-		for (const auto& cell : row) {
-			switch (cell.species) {
-				case Species::Plant: plants++; break;
-				case Species::Herbivore: herbivores++; break;
-				case Species::Carnivore: carnivores++; break;
-				default: break;
-			}
-		}
+int main(int argc, char* argv[]) {
+	Parameters params;
+	if (!parse_arguments(argc, argv, params)) {
+		return 1;
 	}
-	cout << endl << "Plants: " << plants;
-	cout << endl << "Herbivores: " << herbivores;
-	cout << endl << "Carnivores: " << carnivores;
-
-	for (const auto& row : grid) {
-		cout << endl;
-		for (const auto& cell : row) {
-			string c = " ";
-			switch (cell.species) {
-				case Species::Plant:     c = "\033[92mP\033[0m"; break;
-				case Species::Herbivore: c = "\033[94mH\033[0m"; break;
-				case Species::Carnivore: c = "\033[91mC\033[0m"; break;
-				default: break;
-			}
-			cout << c << " ";
+	Snapshot_Reader snapshot;
+	if (!params.restore.empty()) {
+		if (!snapshot.open(params.restore)) {
+			return 1;
 		}
+		snapshot.apply(params);
 	}
-}
-
-/**
- * @brief Simula la evolución del ecosistema a lo largo del tiempo.
- * @param grid Cuadrícula que representa el ecosistema.
- */
-void simulate(Grid& grid) {
-	for (int tick = 0; tick < num_ticks; ++tick) {
-		Grid next_grid = grid;
-		srand(tick);
-		int random = std::rand();
-
-		#pragma omp parallel num_threads(num_threads)
-		{
-			#pragma omp for collapse(2)
-			for (int i = 0; i < grid_size; ++i) {
-				for (int j = 0; j < grid_size; ++j) {
-					update_cell(grid[i][j], grid, next_grid, i, j, random * i / (j + 10) * j + tick * i);
-				}
-			}
-			#pragma omp single
-			{
-				grid = next_grid;
+	if (!validate_parameters(params)) {
+		return 1;
+	}
+	if (params.benchmark != Benchmark::None) {
+		write_report(cout, params, run_benchmark(params));
+		return 0;
+	}
+	if (!params.ensemble.empty()) {
+		return simulate_ensemble(params);
+	}
+	if (params.processes > 1) {
+		return run_distributed(params);
+	}
+	Density_Report density;
+	if (!density.open(params)) {
+		return 1;
+	}
+	Series_Recorder series;
+	if (!params.series.empty() && !series.open(params.series, params.compress_series != 0)) {
+		return 1;
+	}
+	with_layout(params.layout, [&](auto layout) {
+		using Layout = typename decltype(layout)::type;
+		Basic_Ecosystem<Layout> ecosystem = params.restore.empty() ? Basic_Ecosystem<Layout>(params) : Basic_Ecosystem<Layout>(params, snapshot.grid<Layout>(params));
+		with_rules(params.species, [&](const auto& rules) {
+			if (params.restore.empty()) {
+				initialize_grid(ecosystem, rules);
 			}
-			#pragma omp master
-			{
-				if (tick % tick_update == 0) {
-					cout << endl << endl << "Tick: " << tick + 1;
-					print_grid(grid);
-				}
+			else {
+				snapshot.load(ecosystem);
 			}
-		}
-	}
-	print_grid(grid);
+			simulate(ecosystem, rules, density, series);
+		});
+	});
+	return series.close() ? 0 : 1;
 }
-
-/**
- * @brief Punto de entrada del programa. Inicializa y ejecuta la simulación.
- * @return Código de salida del programa.
- */
-int main() {
-	Grid grid = Grid(grid_size, vector<Cell>(grid_size));
-	initialize_grid(grid);
-	simulate(grid);
-	return 0;
-}
\ No newline at end of file